@@ -0,0 +1,95 @@
+// Compares the ReadFiles backends on a synthetic library
+// Usage: read_benchmark <directory> [levels] [rounds]
+// The library is created in directory if it doesn't exist yet, pass a directory on the storage to measure
+// (e.g. /sdcard/ModData/...), page cache effects are visible in the first round against the rest
+
+#include "Utils/FileUtils.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace RuntimeSongLoader;
+
+constexpr int DifficultiesPerLevel = 4;
+
+std::string MakeText(std::mt19937& random, std::size_t size) {
+    static const char characters[] = "{}[]\",:0123456789._abcdefghijklmnopqrstuvwxyz";
+    std::string text(size, ' ');
+    for(auto& character : text)
+        character = characters[random() % (sizeof(characters) - 1)];
+    return text;
+}
+
+std::vector<std::string> CreateLibrary(std::string const& directory, int levels) {
+    std::vector<std::string> paths;
+    std::mt19937 random(levels);
+    for(int i = 0; i < levels; i++) {
+        auto folder = directory + "/level" + std::to_string(i);
+        bool exists = std::filesystem::exists(folder);
+        std::filesystem::create_directories(folder);
+        std::vector<std::pair<std::string, std::size_t>> files = { { folder + "/info.dat", 2 * 1024 } };
+        for(int j = 0; j < DifficultiesPerLevel; j++)
+            files.emplace_back(folder + "/Difficulty" + std::to_string(j) + ".dat", 64 * 1024 + random() % (512 * 1024));
+        for(auto& [path, size] : files) {
+            if(!exists)
+                std::ofstream(path, std::ios::binary) << MakeText(random, size);
+            paths.push_back(path);
+        }
+    }
+    return paths;
+}
+
+double Measure(std::vector<std::string> const& paths, FileUtils::ReadBackend backend, uint64_t& bytes) {
+    auto start = std::chrono::steady_clock::now();
+    // Same batches the prescan uses, one per level
+    for(std::size_t i = 0; i < paths.size(); i += DifficultiesPerLevel + 1) {
+        std::vector<std::string> batch(paths.begin() + i, paths.begin() + i + DifficultiesPerLevel + 1);
+        auto results = FileUtils::ReadFiles(batch, backend);
+        for(auto& result : results)
+            bytes += result.data.size();
+        FileUtils::RecycleBuffers(results);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double MeasureBatched(std::vector<std::string> const& paths, FileUtils::ReadBackend backend, uint64_t& bytes) {
+    auto start = std::chrono::steady_clock::now();
+    auto results = FileUtils::ReadFiles(paths, backend);
+    for(auto& result : results)
+        bytes += result.data.size();
+    FileUtils::RecycleBuffers(results);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        std::printf("Usage: %s <directory> [levels] [rounds]\n", argv[0]);
+        return 1;
+    }
+    std::string directory = argv[1];
+    int levels = argc > 2 ? std::atoi(argv[2]) : 500;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    auto paths = CreateLibrary(directory, levels);
+    std::printf("%d levels, %d files, io_uring %s\n", levels, (int) paths.size(), FileUtils::IsIoUringAvailable() ? "available" : "not available");
+
+    struct Backend {
+        const char* name;
+        FileUtils::ReadBackend backend;
+    };
+    for(auto [name, backend] : { Backend{ "pread", FileUtils::ReadBackend::Pread }, Backend{ "io_uring", FileUtils::ReadBackend::IoUring } }) {
+        for(int round = 0; round < rounds; round++) {
+            uint64_t bytes = 0;
+            double perLevel = Measure(paths, backend, bytes);
+            double batched = MeasureBatched(paths, backend, bytes);
+            std::printf("%-8s round %d: per level %8.2fms, all at once %8.2fms, %.1fMB read\n", name, round, perLevel, batched, bytes / 2.0 / (1024.0 * 1024.0));
+        }
+    }
+    return 0;
+}
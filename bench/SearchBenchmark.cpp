@@ -0,0 +1,110 @@
+// Measures building and querying the search index on a synthetic library
+// Usage: search_benchmark [levels] [queries]
+// The texts are made of words like real song and mapper names, so the posting lists have realistic lengths
+
+#include "Utils/SearchIndex.hpp"
+#include "Utils/StringUtils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace RuntimeSongLoader;
+
+constexpr int VocabularySize = 4000;
+
+std::u16string MakeWord(std::mt19937& random) {
+    static const char16_t characters[] = u"abcdefghijklmnopqrstuvwxyzaeiouaeiou";
+    std::u16string word(3 + random() % 7, u' ');
+    for(auto& character : word)
+        character = characters[random() % (sizeof(characters) / sizeof(char16_t) - 1)];
+    // Some names aren't ASCII, they go through towlower
+    if(random() % 20 == 0)
+        word[0] = u'Ä';
+    return word;
+}
+
+std::u16string MakeField(std::mt19937& random, std::vector<std::u16string> const& vocabulary, int maxWords) {
+    // Zipf like, a few words (and mappers) are very common
+    std::u16string field;
+    int words = 1 + random() % maxWords;
+    for(int i = 0; i < words; i++) {
+        if(i > 0)
+            field += u' ';
+        double uniform = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+        field += vocabulary[static_cast<std::size_t>(std::pow(uniform, 3.0) * (vocabulary.size() - 1))];
+    }
+    return field;
+}
+
+double Microseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int levels = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int queries = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    std::mt19937 random(levels);
+    std::vector<std::u16string> vocabulary;
+    for(int i = 0; i < VocabularySize; i++)
+        vocabulary.push_back(MakeWord(random));
+    std::vector<std::u16string> texts;
+    for(int i = 0; i < levels; i++) {
+        std::u16string text;
+        text += MakeField(random, vocabulary, 4);
+        text += SearchUtils::FieldSeparator;
+        text += MakeField(random, vocabulary, 2);
+        text += SearchUtils::FieldSeparator;
+        text += MakeField(random, vocabulary, 2);
+        text += SearchUtils::FieldSeparator;
+        text += MakeField(random, vocabulary, 1);
+        texts.push_back(StringUtils::FoldCase(text));
+    }
+
+    SearchUtils::SearchIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < levels; i++)
+        index.Add(&texts[i], texts[i]);
+    double buildMicroseconds = Microseconds(start);
+    std::printf("%d levels, %d keys, built in %.2fms\n", levels, (int) index.GetKeysCount(), buildMicroseconds / 1000.0);
+
+    // Queries are parts of words of the library, as typed into the search field
+    struct Kind {
+        const char* name;
+        std::size_t length;
+        bool prefixOnly;
+    };
+    for(auto kind : { Kind{ "2 characters", 2, false }, Kind{ "3 characters", 3, false }, Kind{ "5 characters", 5, false }, Kind{ "prefix of 4", 4, true }, Kind{ "whole word", 0, false } }) {
+        std::vector<double> timings;
+        std::size_t results = 0;
+        for(int i = 0; i < queries; i++) {
+            auto& word = vocabulary[random() % vocabulary.size()];
+            std::size_t length = kind.length == 0 ? word.size() : std::min(kind.length, word.size());
+            std::size_t offset = kind.prefixOnly ? 0 : random() % (word.size() - length + 1);
+            auto query = word.substr(offset, length);
+            auto queryStart = std::chrono::steady_clock::now();
+            results += index.Search(query, kind.prefixOnly).size();
+            timings.push_back(Microseconds(queryStart));
+        }
+        std::sort(timings.begin(), timings.end());
+        double total = 0.0;
+        for(auto timing : timings)
+            total += timing;
+        std::printf("%-13s average %7.1fus, median %7.1fus, p99 %7.1fus, max %7.1fus, %.0f results\n", kind.name, total / timings.size(), timings[timings.size() / 2], timings[timings.size() * 99 / 100], timings.back(), (double) results / timings.size());
+    }
+
+    // Incremental updates, like a refresh that changed a few levels
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < 100; i++) {
+        index.Remove(&texts[i]);
+        index.Add(&texts[i], texts[i]);
+    }
+    std::printf("Replaced 100 levels in %.2fms\n", Microseconds(start) / 1000.0);
+    return 0;
+}
@@ -5,9 +5,14 @@
 #include "BeatmapSaveDataVersion3/BeatmapSaveData.hpp"
 
 #include "CustomTypes/CustomLevelInfoSaveData.hpp"
+
+#include "API.hpp"
+
 namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
 
-    void AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event);
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event, std::string_view owner = "");
+
+    bool RemoveBeatmapDataBasicInfoLoadedEvent(EventHandle handle);
 
     void InstallHooks();
 
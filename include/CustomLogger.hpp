@@ -1,13 +1,46 @@
 #pragma once
 
-//#define LOG_INFO(...)
-#define LOG_INFO(...) getLogger().info(__VA_ARGS__) 
-#define LOG_DEBUG(...) 
-//#define LOG_DEBUG(...) getLogger().debug(__VA_ARGS__) 
-//#define LOG_WARN(...)
-#define LOG_WARN(...) getLogger().warning(__VA_ARGS__) 
-//#define LOG_ERROR(...)
-#define LOG_ERROR(...) getLogger().error(__VA_ARGS__) 
-
 #include "beatsaber-hook/shared/utils/utils.h"
-Logger& getLogger();
\ No newline at end of file
+
+// Messages above this level are stripped at compile time, arguments included
+// 0 = Off, 1 = Error, 2 = Warn, 3 = Info, 4 = Debug
+#ifndef SONGLOADER_LOG_LEVEL
+#define SONGLOADER_LOG_LEVEL 3
+#endif
+
+#if SONGLOADER_LOG_LEVEL >= 3
+#define LOG_INFO(...) RuntimeSongLoader::AsyncLogger::Log(RuntimeSongLoader::AsyncLogger::Level::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...)
+#endif
+#if SONGLOADER_LOG_LEVEL >= 4
+#define LOG_DEBUG(...) RuntimeSongLoader::AsyncLogger::Log(RuntimeSongLoader::AsyncLogger::Level::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+#if SONGLOADER_LOG_LEVEL >= 2
+#define LOG_WARN(...) RuntimeSongLoader::AsyncLogger::Log(RuntimeSongLoader::AsyncLogger::Level::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...)
+#endif
+#if SONGLOADER_LOG_LEVEL >= 1
+#define LOG_ERROR(...) RuntimeSongLoader::AsyncLogger::Log(RuntimeSongLoader::AsyncLogger::Level::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)
+#endif
+
+Logger& getLogger();
+
+namespace RuntimeSongLoader::AsyncLogger {
+
+    enum class Level : uint8_t {
+        Error,
+        Warn,
+        Info,
+        Debug
+    };
+
+    /// @brief Formats into a lock-free ring buffer, a background thread blocked on a futex while it is empty writes it to getLogger()
+    void Log(Level level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+}
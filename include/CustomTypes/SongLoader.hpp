@@ -7,49 +7,123 @@
 #include "CustomTypes/SongLoaderCustomBeatmapLevelPack.hpp"
 #include "CustomTypes/CustomLevelInfoSaveData.hpp"
 
+#include "API.hpp"
+#include "FrameWorkQueue.hpp"
+#include "LevelRegistry.hpp"
+#include "Utils/LevelInfoUtils.hpp"
+#include "Utils/EventList.hpp"
+
 #include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp" 
 #include "GlobalNamespace/CustomBeatmapLevelCollection.hpp" 
 #include "GlobalNamespace/CustomBeatmapLevelPack.hpp" 
 #include "GlobalNamespace/StandardLevelInfoSaveData.hpp" 
 #include "GlobalNamespace/EnvironmentInfoSO.hpp" 
 #include "GlobalNamespace/BeatmapDataLoader.hpp" 
+#include "GlobalNamespace/BeatmapLevelsModel.hpp" 
+#include "GlobalNamespace/CustomLevelLoader.hpp" 
 #include "UnityEngine/MonoBehaviour.hpp" 
-#include "System/Collections/Generic/Dictionary_2.hpp"
 
+#include <chrono>
+#include <mutex>
 #include <vector>
 
 namespace RuntimeSongLoader {
-    using DictionaryType = ::System::Collections::Generic::Dictionary_2<StringW, ::GlobalNamespace::CustomPreviewBeatmapLevel*>*;
+    using SongsLoadedCallback = std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)>;
+
+    /// @brief Refresh requests that arrived while loading or in a burst, merged into one refresh
+    struct QueuedRefreshRequest {
+        bool pending = false;
+        bool fullRefresh = false;
+        std::vector<SongsLoadedCallback> callbacks;
+        std::chrono::steady_clock::time_point startAt;
+        // Set when the request can't start outside the menu, MenuLoaded starts it
+        bool waitForMenu = false;
+    };
 }
 
 DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoader, UnityEngine::MonoBehaviour,
     private:
         static SongLoader* Instance;
 
-        static std::vector<std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)>> LoadedEvents;
-        static std::mutex LoadedEventsMutex;
+        static EventList<std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&> LoadedEvents;
 
-        static std::vector<std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)>> RefreshLevelPacksEvents;
-        static std::mutex RefreshLevelPacksEventsMutex;
+        static EventList<SongLoaderBeatmapLevelPackCollectionSO*> RefreshLevelPacksEvents;
         
-        static std::vector<std::function<void()>> SongDeletedEvents;
-        static std::mutex SongDeletedEventsMutex;
+        static EventList<GlobalNamespace::CustomPreviewBeatmapLevel*> SongDeletedEvents;
+
+        static EventList<LevelsChangeSet const&> LevelsChangedEvents;
 
         std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> LoadedLevels;
 
-        void MenuLoaded();
+        // Loaded levels by path, safe to use from the refresh workers
+        LevelRegistry Registry;
+
+        GlobalNamespace::BeatmapLevelsModel* CommittedBeatmapLevelsModel = nullptr;
+        bool CommittedIncludeDefault = false;
+
+        // Main thread work that has to wait until the running refresh committed its levels
+        std::vector<std::function<void()>> DeferredCommits;
+
+        // Commit work of refreshes, run from Update within a per frame budget
+        FrameWorkQueue CommitQueue;
+        // Set until the queued commit of a refresh ran completely
+        bool IsCommitting = false;
+
+        // Set while a refresh started outside the menu scans, it's throttled and doesn't show progress
+        bool IsBackgroundScan = false;
+        // Commit of a background scan that finished outside the menu
+        std::function<void()> PendingCommit;
+
+        static BackgroundScanOptions BackgroundOptions;
+        static std::mutex BackgroundOptionsMutex;
+
+        // Only the first refresh restores the snapshot
+        bool SnapshotRestoreAttempted = false;
+
+        QueuedRefreshRequest QueuedRefresh;
+        std::chrono::steady_clock::time_point LastRefreshRequest;
+
+        /// @brief Starts scanning the songs, every callback gets called once the levels are committed (main thread only)
+        /// @return False if the refresh can't run in the current scene
+        bool StartRefresh(bool fullRefresh, std::vector<SongsLoadedCallback> const& callbacks);
 
-        CustomJSONData::CustomLevelInfoSaveData* GetStandardLevelInfoSaveData(std::string const& customLevelPath);
-        GlobalNamespace::EnvironmentInfoSO* LoadEnvironmentInfo(StringW environmentName, bool allDirections);
-        GlobalNamespace::CustomPreviewBeatmapLevel* LoadCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, std::string& outHash);
+        /// @brief Creates the levels of the last snapshot without reading their folders and queues their commit (refresh worker only)
+        /// @return False if there is no snapshot
+        bool RestoreSnapshot(std::vector<SongsLoadedCallback> const& callbacks);
+
+        /// @brief Saves the loaded levels as snapshot for the next start (worker only)
+        void SaveSnapshot(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const& levels);
+
+        /// @brief Starts the queued refresh once the loader is idle and its debounce window passed (main thread only)
+        void StartQueuedRefresh();
+
+        /// @brief Queues committing the levels of a finished refresh (main thread only)
+        void CommitRefresh(std::vector<SongsLoadedCallback> const& callbacks, std::shared_ptr<LevelsChangeSet> const& changeSet);
+
+        /// @brief Splits RefreshLevelPacks into steps that can run in different frames (main thread only)
+        std::vector<FrameWorkQueue::Step> GetRefreshLevelPacksSteps(bool includeDefault, bool force);
+
+        CustomJSONData::CustomLevelInfoSaveData* ParseStandardLevelInfoSaveData(std::string_view infoText, std::string const& path);
+        GlobalNamespace::EnvironmentInfoSO* LoadEnvironmentInfo(GlobalNamespace::CustomLevelLoader* customlevelLoader, std::string_view environmentName, bool allDirections);
+        /// @brief Reads the info.dat once and parses it into the managed save data the level is created from
+        GlobalNamespace::CustomPreviewBeatmapLevel* LoadCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, std::string& outHash);
+        /// @brief Creates the level from already known data, doesn't hash or read the song duration
+        GlobalNamespace::CustomPreviewBeatmapLevel* CreateCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, LevelInfoUtils::LevelInfo const& info, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, std::string const& hash);
         
-        void UpdateSongDuration(GlobalNamespace::CustomPreviewBeatmapLevel* level, std::string const& customLevelPath);
-        float GetLengthFromMap(GlobalNamespace::CustomPreviewBeatmapLevel* level, std::string const& customLevelPath);
+        void UpdateSongDuration(GlobalNamespace::CustomPreviewBeatmapLevel* level, std::string const& customLevelPath, LevelInfoUtils::LevelInfo const& info);
+        float GetLengthFromMap(GlobalNamespace::CustomPreviewBeatmapLevel* level, std::string const& customLevelPath, LevelInfoUtils::LevelInfo const& info);
 
-        List<GlobalNamespace::CustomPreviewBeatmapLevel*>* LoadSongsFromPath(std::string_view path, std::vector<std::string>& loadedPaths);
+        /// @brief Removes the levels from the registry, packs, search index and cache (main thread only)
+        /// @return The removed level of every path or nullptr if it wasn't loaded
+        std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> RemoveLoadedLevels(std::vector<std::string> const& paths);
+
+        /// @brief Adds loaded levels to the packs and search index (main thread only)
+        void AddLoadedLevels(std::vector<SongOperationStatus>& statuses);
 
-        DECLARE_INSTANCE_FIELD(DictionaryType, CustomLevels);
-        DECLARE_INSTANCE_FIELD(DictionaryType, CustomWIPLevels);
+        /// @brief Runs commit now or after the running refresh committed its levels (main thread only)
+        void CommitWhenIdle(std::function<void()> const& commit);
+
+        List<GlobalNamespace::CustomPreviewBeatmapLevel*>* LoadSongsFromPath(std::string_view path, std::vector<std::string>& loadedPaths);
 
         DECLARE_INSTANCE_FIELD(GlobalNamespace::BeatmapDataLoader*, beatmapDataLoader);
 
@@ -71,26 +145,74 @@ DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoader, UnityEngine::MonoBehaviour,
 
         std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLoadedLevels();
 
-        static void AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event) {
-            std::lock_guard<std::mutex> lock(LoadedEventsMutex);
-            LoadedEvents.push_back(event);
+        /// @brief Finds a loaded level by its levelID without touching il2cpp, safe from any thread
+        GlobalNamespace::CustomPreviewBeatmapLevel* GetLevelById(std::string_view levelID);
+
+        /// @brief Gets the save data the level was created with, doesn't parse anything
+        /// @return nullptr if the level has none
+        CustomJSONData::CustomLevelInfoSaveData* LoadStandardLevelInfoSaveData(GlobalNamespace::CustomPreviewBeatmapLevel* level);
+
+        /// @brief Commits the levels of a background scan that finished outside the menu (main thread only)
+        void MenuLoaded();
+
+        static void SetBackgroundScanOptions(BackgroundScanOptions const& options);
+        static BackgroundScanOptions GetBackgroundScanOptions();
+
+        FrameWorkQueue& GetCommitQueue() {
+            return CommitQueue;
+        }
+
+        static EventHandle AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event, std::string_view owner = "") {
+            return LoadedEvents.Add(event, owner);
         }
 
-        static void AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event) {
-            std::lock_guard<std::mutex> lock(RefreshLevelPacksEventsMutex);
-            RefreshLevelPacksEvents.push_back(event);
+        static EventHandle AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event, std::string_view owner = "") {
+            return RefreshLevelPacksEvents.Add(event, owner);
         }
 
-        static void AddSongDeletedEvent(std::function<void()> const& event) {
-            std::lock_guard<std::mutex> lock(SongDeletedEventsMutex);
-            SongDeletedEvents.push_back(event);
+        static EventHandle AddSongDeletedEvent(std::function<void()> const& event, std::string_view owner = "") {
+            return SongDeletedEvents.Add([event](GlobalNamespace::CustomPreviewBeatmapLevel*) { event(); }, owner);
         }
 
-        void RefreshLevelPacks(bool includeDefault) const;
+        static EventHandle AddSongDeletedEvent(std::function<void(GlobalNamespace::CustomPreviewBeatmapLevel*)> const& event, std::string_view owner = "") {
+            return SongDeletedEvents.Add(event, owner);
+        }
+
+        static EventHandle AddLevelsChangedEvent(std::function<void(LevelsChangeSet const&)> const& event, std::string_view owner = "") {
+            return LevelsChangedEvents.Add(event, owner);
+        }
+
+        static bool RemoveSongsLoadedEvent(EventHandle handle) {
+            return LoadedEvents.Remove(handle);
+        }
+
+        static bool RemoveRefreshLevelPacksEvent(EventHandle handle) {
+            return RefreshLevelPacksEvents.Remove(handle);
+        }
+
+        static bool RemoveSongDeletedEvent(EventHandle handle) {
+            return SongDeletedEvents.Remove(handle);
+        }
+
+        static bool RemoveLevelsChangedEvent(EventHandle handle) {
+            return LevelsChangedEvents.Remove(handle);
+        }
+
+        /// @brief Removes song folders left in the trash by an interrupted DeleteSong and old extracted files of zips (blocking)
+        static void EmptyTrash();
+
+        /// @param force If false the packs are only committed to the game when they changed, the RefreshLevelPacks event is invoked either way
+        void RefreshLevelPacks(bool includeDefault, bool force = true);
         
-        void RefreshSongs(bool fullRefresh, std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& songsLoaded = nullptr);
+        /// @brief Requests a refresh, requests during loading or in a burst are merged into one refresh (main thread only)
+        /// A merged refresh is full if any request was, songsLoaded of every request gets called once it's done
+        void RefreshSongs(bool fullRefresh, SongsLoadedCallback const& songsLoaded = nullptr);
 
         void DeleteSong(std::string_view path, std::function<void()> const& finished);
+
+        void DeleteSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished);
+
+        void AddSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished);
         
         DECLARE_CTOR(ctor);
         DECLARE_SIMPLE_DTOR();
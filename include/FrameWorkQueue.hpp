@@ -0,0 +1,51 @@
+#pragma once
+
+#include "API.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace RuntimeSongLoader {
+
+    /// @brief Main thread work that gets spread over frames instead of stalling a single one
+    /// Run every frame, it runs steps until the budget is used up, but always at least one so the work progresses
+    class FrameWorkQueue {
+        public:
+            /// @brief Resumable step, returns false if it has to be called again
+            using Step = std::function<bool()>;
+
+        private:
+            std::deque<Step> steps;
+            std::atomic<uint64_t> budgetMicroseconds = 2000;
+            // The report is read from other threads through the API
+            mutable std::mutex reportMutex;
+            FrameWorkReport report;
+
+        public:
+            /// @brief Queues a step that is done after a single call (main thread only)
+            void Enqueue(std::function<void()> const& step);
+
+            void Enqueue(std::vector<std::function<void()>> const& steps);
+
+            /// @brief Queues a step that gets called until it returns true (main thread only)
+            void EnqueueResumable(Step const& step);
+
+            void EnqueueResumable(std::vector<Step> const& steps);
+
+            bool Empty() const;
+
+            /// @brief Runs the queued steps for up to one frame budget (main thread only)
+            void Run();
+
+            /// @brief Thread safe
+            void SetBudget(uint64_t microseconds);
+
+            /// @brief Thread safe
+
+            FrameWorkReport GetReport() const;
+    };
+
+}
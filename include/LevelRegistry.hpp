@@ -0,0 +1,83 @@
+#pragma once
+#include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp"
+
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace RuntimeSongLoader {
+
+    /// @brief Thread safe native map of the loaded levels by path, usable from the loading workers
+    /// Registered levels are kept alive with GC handles
+    class LevelRegistry {
+        private:
+            // Transparent so lookups don't have to copy the string_view
+            struct StringHash {
+                using is_transparent = void;
+                std::size_t operator()(std::string_view text) const {
+                    return std::hash<std::string_view>()(text);
+                }
+            };
+            template<class T>
+            using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+            struct Entry {
+                GlobalNamespace::CustomPreviewBeatmapLevel* level = nullptr;
+                bool wip = false;
+                std::string levelID;
+                uint32_t handle = 0;
+                // Of the folder the level was created from, nullopt if unknown
+                std::optional<int> directoryHash;
+                // False for levels restored from a snapshot and after a full refresh until the folder was checked
+                bool verified = true;
+            };
+
+            mutable std::shared_mutex mutex;
+            StringMap<Entry> entries;
+            // Copies of a song in several folders share a levelID, the first registered one is found until it's removed
+            StringMap<std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*>> levelsById;
+
+            void RemoveUnsafe(StringMap<Entry>::iterator entry);
+
+        public:
+            ~LevelRegistry();
+
+            GlobalNamespace::CustomPreviewBeatmapLevel* Find(std::string_view path) const;
+
+            /// @brief Registers the level if there is none at path yet
+            /// @param directoryHash Directory hash the level was created from
+            /// @param verified False if the folder wasn't checked against directoryHash yet
+            /// @return The level that is registered at path afterwards
+            GlobalNamespace::CustomPreviewBeatmapLevel* TryAdd(std::string_view path, bool wip, GlobalNamespace::CustomPreviewBeatmapLevel* level, std::string_view levelID, std::optional<int> directoryHash = std::nullopt, bool verified = true);
+
+            /// @return True if the level at path is verified or there is none
+            bool IsVerified(std::string_view path) const;
+
+            /// @brief Gets the directory hash a level was created from, nullopt if it's unknown or not registered
+            std::optional<int> GetDirectoryHash(std::string_view path) const;
+
+            void MarkVerified(std::string_view path);
+
+            /// @brief Keeps the levels but has them checked against their folders again, used by full refreshes
+            void MarkAllUnverified();
+
+            bool Empty() const;
+
+            /// @param wip Set to if the removed level was a WIP level
+            /// @return The removed level or nullptr if there was none at path
+            GlobalNamespace::CustomPreviewBeatmapLevel* Remove(std::string_view path, bool* wip = nullptr);
+
+            /// @brief Removes every level whose path isn't in paths
+            void RemoveExcept(std::vector<std::string> const& paths);
+
+            void Clear();
+
+            GlobalNamespace::CustomPreviewBeatmapLevel* FindById(std::string_view levelID) const;
+
+            std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLevels(bool wip) const;
+    };
+
+}
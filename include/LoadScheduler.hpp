@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+
+namespace RuntimeSongLoader {
+
+    /// @brief Classes of loading work, lower values preempt higher ones
+    enum class LoadPriority {
+        /// @brief Loading a level the player wants to play
+        Interactive,
+        /// @brief Refreshes, adding and deleting songs
+        Refresh,
+        /// @brief Maintenance nobody waits for, like emptying the trash
+        Background
+    };
+
+}
+
+/// @brief Lets loading work of lower priority wait while more important work is queued or running
+/// Work doesn't get interrupted, lower priorities only wait at file boundaries by calling Yield
+namespace RuntimeSongLoader::LoadScheduler {
+
+    /// @brief Marks work of priority as queued or running until End is called, can be called from any thread
+    void Begin(LoadPriority priority);
+
+    void End(LoadPriority priority);
+
+    /// @brief Blocks while work of a higher priority than priority is queued or running
+    /// Call it between files, waits at most a few seconds so stuck work can't starve the rest
+    void Yield(LoadPriority priority);
+
+    /// @brief Runs work on a new task, it's marked as queued right away so lower priorities yield before it starts
+    void Run(LoadPriority priority, std::function<void()> const& work);
+
+    /// @brief Marks work of a priority as running for the lifetime of the scope
+    class Scope {
+        private:
+            LoadPriority priority;
+
+        public:
+            explicit Scope(LoadPriority priority) : priority(priority) {
+                Begin(priority);
+            }
+
+            ~Scope() {
+                End(priority);
+            }
+
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+    };
+
+}
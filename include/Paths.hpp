@@ -3,5 +3,8 @@
 std::string GetBaseLevelsPath();
 const std::string CustomLevelsFolder = "CustomLevels";
 const std::string CustomWIPLevelsFolder = "CustomWIPLevels";
+const std::string TrashFolder = ".SongLoaderTrash";
+const std::string ExtractedArchivesFolder = ".SongLoaderExtracted";
+const std::string LibrarySnapshotFile = "LibrarySnapshot.bin";
 const std::string CustomLevelPrefixID = "custom_level_";
 const std::string CustomLevelPackPrefixID = "custom_levelPack_";
\ No newline at end of file
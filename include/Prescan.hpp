@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Utils/SnapshotUtils.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/// @brief Native part of the first refresh that runs while the game is still starting
+/// Loads the cache and snapshot, enumerates the song folders and fingerprints, hashes and probes the duration of every folder
+/// Creating the levels needs il2cpp and the menu's CustomLevelLoader, so that's left to the refresh
+namespace RuntimeSongLoader::Prescan {
+
+    /// @brief Starts the prescan on a native thread, doesn't call il2cpp
+    void Start();
+
+    /// @brief Blocks until the prescan is done, returns right away if it never started
+    void Wait();
+
+    /// @brief Takes the enumerated song folders of both roots, only the first call after the prescan gets them
+    std::optional<std::vector<std::string>> TakeFolders();
+
+    /// @brief Takes the loaded snapshot, only the first call after the prescan gets it
+    std::optional<std::vector<SnapshotUtils::SnapshotLevel>> TakeSnapshot();
+
+}
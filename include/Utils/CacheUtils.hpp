@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <optional>
 #include <vector>
@@ -10,10 +11,17 @@ namespace RuntimeSongLoader::CacheUtils {
         int directoryHash = 0;
         std::optional<std::string> sha1 = std::nullopt;
         std::optional<float> songDuration = std::nullopt;
+        /// @brief Newest write time of the level's files, sorts the levels by date added
+        int64_t lastWriteTime = 0;
+        /// @brief Size of the level's .dat files from the last listing, not saved
+        uint64_t dataFilesSize = 0;
     };
 
     std::optional<CacheData> GetCacheData(std::string const& path);
 
+    /// @brief Gets the cached data without checking if the folder changed since
+    std::optional<CacheData> PeekCacheData(std::string const& path);
+
     void UpdateCacheData(std::string const& path, CacheData const& newData);
 
     void RemoveCacheData(std::string const& path);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "API.hpp"
+
+#include "CustomLogger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace RuntimeSongLoader {
+
+    // Shared by all lists so a handle can never remove a callback of another event
+    inline std::atomic<EventHandle> NextEventHandle = 1;
+
+    // Callbacks taking longer than this get logged, 0 disables the warning
+    inline std::atomic<uint64_t> EventWarningThresholdMicroseconds = 5000;
+
+    struct EventSubscriberCounters {
+        std::atomic<uint64_t> calls = 0;
+        std::atomic<uint64_t> totalMicroseconds = 0;
+        std::atomic<uint64_t> maxMicroseconds = 0;
+        std::array<std::atomic<uint64_t>, EventLatencyBucketsCount> latencyHistogram = {};
+
+        void Record(uint64_t microseconds) {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+            auto max = maxMicroseconds.load(std::memory_order_relaxed);
+            while(microseconds > max && !maxMicroseconds.compare_exchange_weak(max, microseconds, std::memory_order_relaxed));
+            auto bucket = std::upper_bound(EventLatencyBucketLimits.begin(), EventLatencyBucketLimits.end(), microseconds) - EventLatencyBucketLimits.begin();
+            latencyHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    class EventListBase {
+        public:
+            virtual void AppendStats(std::vector<EventSubscriberStats>& stats) const = 0;
+
+            /// @brief All event lists, they register themselves on construction
+            static std::vector<EventListBase const*>& GetEventLists() {
+                static std::vector<EventListBase const*> eventLists;
+                return eventLists;
+            }
+
+        protected:
+            EventListBase() {
+                GetEventLists().push_back(this);
+            }
+    };
+
+    /// @brief Callback list that is dispatched without holding locks
+    /// Writers copy the list and publish the copy by swapping a pointer, Invoke iterates an immutable snapshot,
+    /// so callbacks may add or remove callbacks and concurrent invokes only contend on the pointer copy
+    template<typename... TArgs>
+    class EventList : public EventListBase {
+        public:
+            using Callback = std::function<void(TArgs...)>;
+
+        private:
+            struct Subscriber {
+                EventHandle handle;
+                std::string owner;
+                Callback callback;
+                std::shared_ptr<EventSubscriberCounters> counters;
+            };
+            using Snapshot = std::vector<Subscriber>;
+
+            const char* name;
+            std::shared_ptr<const Snapshot> subscribers = std::make_shared<const Snapshot>();
+            // Only guards copying and swapping the subscribers pointer, never held while callbacks run
+            mutable std::mutex snapshotMutex;
+            std::mutex writeMutex;
+
+            std::shared_ptr<const Snapshot> GetSnapshot() const {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+                return subscribers;
+            }
+
+            void SetSnapshot(std::shared_ptr<const Snapshot> snapshot) {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+                subscribers.swap(snapshot);
+                // The old snapshot is released after unlocking, destroying it can't block readers
+            }
+
+            void InvokeSubscriber(Subscriber const& subscriber, TArgs... args) const {
+                auto start = std::chrono::steady_clock::now();
+                subscriber.callback(args...);
+                uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+                subscriber.counters->Record(microseconds);
+                auto threshold = EventWarningThresholdMicroseconds.load(std::memory_order_relaxed);
+                if(threshold > 0 && microseconds >= threshold)
+                    LOG_WARN("%s callback of %s took %dms!", name, subscriber.owner.empty() ? "an unknown mod" : subscriber.owner.c_str(), (int) (microseconds / 1000));
+            }
+
+        public:
+            explicit EventList(const char* name) : name(name) {}
+
+            EventHandle Add(Callback const& callback, std::string_view owner = "") {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                auto updated = std::make_shared<Snapshot>(*GetSnapshot());
+                EventHandle handle = NextEventHandle++;
+                updated->push_back({ handle, std::string(owner), callback, std::make_shared<EventSubscriberCounters>() });
+                SetSnapshot(std::move(updated));
+                return handle;
+            }
+
+            bool Remove(EventHandle handle) {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                auto current = GetSnapshot();
+                auto search = std::find_if(current->begin(), current->end(), [handle](auto& subscriber) { return subscriber.handle == handle; });
+                if(search == current->end())
+                    return false;
+                auto updated = std::make_shared<Snapshot>();
+                updated->reserve(current->size() - 1);
+                for(auto& subscriber : *current) {
+                    if(subscriber.handle != handle)
+                        updated->push_back(subscriber);
+                }
+                SetSnapshot(std::move(updated));
+                return true;
+            }
+
+            void Invoke(TArgs... args) const {
+                auto snapshot = GetSnapshot();
+                for(auto& subscriber : *snapshot)
+                    InvokeSubscriber(subscriber, args...);
+            }
+
+            /// @brief Splits an Invoke of the current callbacks into one step per callback
+            /// The arguments are copied once and shared by the steps, so they can run in later frames
+            std::vector<std::function<void()>> MakeInvokeSteps(TArgs... args) const {
+                auto snapshot = GetSnapshot();
+                auto storedArgs = std::make_shared<std::tuple<std::decay_t<TArgs>...>>(args...);
+                std::vector<std::function<void()>> steps;
+                steps.reserve(snapshot->size());
+                for(std::size_t i = 0; i < snapshot->size(); i++) {
+                    steps.emplace_back([this, snapshot, storedArgs, i] {
+                        std::apply([this, &snapshot, i](auto&... args) { InvokeSubscriber((*snapshot)[i], args...); }, *storedArgs);
+                    });
+                }
+                return steps;
+            }
+
+            bool Empty() const {
+                return GetSnapshot()->empty();
+            }
+
+            void AppendStats(std::vector<EventSubscriberStats>& stats) const override {
+                auto snapshot = GetSnapshot();
+                for(auto& subscriber : *snapshot) {
+                    auto& counters = *subscriber.counters;
+                    EventSubscriberStats& subscriberStats = stats.emplace_back();
+                    subscriberStats.event = name;
+                    subscriberStats.owner = subscriber.owner;
+                    subscriberStats.handle = subscriber.handle;
+                    subscriberStats.calls = counters.calls.load(std::memory_order_relaxed);
+                    subscriberStats.totalMicroseconds = counters.totalMicroseconds.load(std::memory_order_relaxed);
+                    subscriberStats.maxMicroseconds = counters.maxMicroseconds.load(std::memory_order_relaxed);
+                    for(std::size_t i = 0; i < EventLatencyBucketsCount; i++)
+                        subscriberStats.latencyHistogram[i] = counters.latencyHistogram[i].load(std::memory_order_relaxed);
+                }
+            }
+    };
+
+}
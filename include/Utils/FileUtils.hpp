@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <optional>
 
 namespace RuntimeSongLoader::FileUtils {
     
@@ -10,8 +13,61 @@ namespace RuntimeSongLoader::FileUtils {
 
     const char* ReadAllBytes(std::string_view path, size_t& outSize);
 
-    std::vector<std::string> GetFolders(std::string_view path);
+    struct DirectoryEntry {
+        std::string name;
+        bool isDirectory = false;
+        /// @brief Symlinks are followed like for isDirectory
+        bool isRegularFile = false;
+        /// @brief Only set if the entries were listed with statFiles
+        uint64_t size = 0;
+        /// @brief Seconds since the epoch, only set if the entries were listed with statFiles
+        int64_t lastWriteTime = 0;
+    };
+
+    /// @brief Lists a directory in batches with getdents64, entries are only stat'ed relative to the open directory
+    /// if their type is unknown or a symlink, or with statFiles for all non directories
+    /// @return nullopt if path isn't a readable directory
+    std::optional<std::vector<DirectoryEntry>> ListDirectory(std::string_view path, bool statFiles = false);
+
+    /// @param fileExtension Regular files ending with it (ignoring the case) are included too, like zipped songs
+    std::vector<std::string> GetFolders(std::string_view path, std::string_view fileExtension = "");
+
+    /// @brief Gets the folders of every path, the paths are listed concurrently and the result keeps their order
+    std::vector<std::string> GetFolders(std::vector<std::string> const& paths, std::string_view fileExtension = "");
+
+    enum class ReadBackend {
+        /// @brief io_uring if the kernel and seccomp policy allow it, pread otherwise
+        Auto,
+        IoUring,
+        Pread
+    };
+
+    struct ReadResult {
+        /// @brief If the file could be opened
+        bool exists = false;
+        std::string data;
+    };
+
+    /// @brief Reads whole files, up to a queue of them at once
+    /// With io_uring the reads of a queue are submitted together and complete in any order, pread reads them one after another
+    /// The data buffers come from a pool, give them back with RecycleBuffers once they're not needed anymore
+    /// @param backend Falls back to pread if IoUring isn't available
+    /// @return One result per path in the same order
+    std::vector<ReadResult> ReadFiles(std::vector<std::string> const& paths, ReadBackend backend = ReadBackend::Auto);
+
+    /// @brief Returns the data buffers of results to the pool that ReadFiles takes them from
+    /// The pool is capped in bytes, large buffers and the ones over the cap are freed instead
+    void RecycleBuffers(std::vector<ReadResult>& results);
+
+    /// @brief Frees the pooled buffers, once no more batches of ReadFiles are coming
+    void ReleaseBufferPool();
+
+    /// @brief If ReadBackend::IoUring can be used, the first call probes it
+    bool IsIoUringAvailable();
     
-    void DeleteFolder(std::string_view path);
+    bool DeleteFolder(std::string_view path);
+
+    /// @brief Renames the folder into trashPath so it can be deleted later, returns the new path
+    std::optional<std::string> MoveToTrash(std::string_view path, std::string_view trashPath);
 
 }
\ No newline at end of file
@@ -1,11 +1,29 @@
 #pragma once
-#include "GlobalNamespace/StandardLevelInfoSaveData.hpp"
-#include "CustomTypes/CustomLevelInfoSaveData.hpp"
-
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace RuntimeSongLoader::HashUtils {
     
-    std::optional<std::string> GetCustomLevelHash(CustomJSONData::CustomLevelInfoSaveData* level, std::string const& customLevelPath);
+    /// @brief Gets the hash of a level from the cache or hashes the info.dat and difficultyFiles
+    std::optional<std::string> GetCustomLevelHash(std::string const& customLevelPath, std::vector<std::string> const& difficultyFiles);
+    /// @brief Hashes the info.dat and difficultyFiles of a level without touching il2cpp, ignores the cache
+    std::optional<std::string> ComputeCustomLevelHash(std::string const& customLevelPath, std::vector<std::string> const& difficultyFiles);
+    /// @brief Same hash as ComputeCustomLevelHash from files that are already read, leave out missing difficulty files
+    std::string HashLevelData(std::string_view infoData, std::vector<std::string_view> const& difficultyData);
+
+    struct DirectoryInfo {
+        /// @brief Changes when a file of the level is added, removed or written
+        int hash = 0;
+        /// @brief Newest write time of the level's files in seconds since the epoch
+        int64_t lastWriteTime = 0;
+        /// @brief Size of the .dat files loading and hashing read, 0 for zipped songs
+        uint64_t dataFilesSize = 0;
+    };
+
+    /// @brief Fingerprints a song folder or zipped song from a single listing
+    std::optional<DirectoryInfo> GetDirectoryInfo(std::string_view path);
     std::optional<int> GetDirectoryHash(std::string_view path);
 }
\ No newline at end of file
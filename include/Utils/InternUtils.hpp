@@ -0,0 +1,41 @@
+#pragma once
+#include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
+#include "GlobalNamespace/BeatmapDifficulty.hpp"
+#include "GlobalNamespace/PreviewDifficultyBeatmapSet.hpp"
+#include "GlobalNamespace/StandardLevelInfoSaveData.hpp"
+#include "System/Collections/Generic/IReadOnlyList_1.hpp"
+
+#include "API.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace RuntimeSongLoader::InternUtils {
+
+    struct PreviewDifficultyBeatmapSetInfo {
+        GlobalNamespace::BeatmapCharacteristicSO* beatmapCharacteristic = nullptr;
+        std::vector<GlobalNamespace::BeatmapDifficulty> beatmapDifficulties;
+    };
+
+    /// @brief Gets a shared array of preview sets, levels with the same characteristics and difficulties get the same managed objects
+    /// The returned array and its sets must not be modified
+    ::System::Collections::Generic::IReadOnlyList_1<GlobalNamespace::PreviewDifficultyBeatmapSet*>* GetPreviewDifficultyBeatmapSets(std::vector<PreviewDifficultyBeatmapSetInfo> const& sets);
+
+    /// @brief Gets the shared managed instance of text, the first instance of every text becomes the shared one
+    StringW InternString(StringW text);
+
+    /// @brief Same as above for a native text, only creates a managed string if the text wasn't interned yet
+    StringW InternString(std::string_view text);
+
+    /// @brief Replaces the repeating strings of the save data (authors, environments, characteristic and difficulty names) with shared ones
+    void InternStrings(GlobalNamespace::StandardLevelInfoSaveData* standardLevelInfoSaveData);
+
+    InternReport GetReport();
+
+    /// @brief Drops the interned objects no level uses anymore, the tables only hold weak references
+    void RemoveCollected();
+
+    /// @brief Starts counting the shared objects from zero, the interned objects are kept
+    void ResetReport();
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RuntimeSongLoader::LevelInfoUtils {
+
+    struct DifficultyBeatmapSetInfo {
+        std::string beatmapCharacteristicName;
+        /// @brief Serialized difficulty names in the order of the info.dat
+        std::vector<std::string> difficulties;
+        std::vector<std::string> beatmapFilenames;
+    };
+
+    /// @brief Compact native copy of the info.dat fields a preview level is created from
+    /// The prescan parses it without il2cpp, level loading copies it from the managed save data
+    struct LevelInfo {
+        std::string songName;
+        std::string songSubName;
+        std::string songAuthorName;
+        std::string levelAuthorName;
+        float beatsPerMinute = 0.0f;
+        float songTimeOffset = 0.0f;
+        float shuffle = 0.0f;
+        float shufflePeriod = 0.0f;
+        float previewStartTime = 0.0f;
+        float previewDuration = 0.0f;
+        std::string songFilename;
+        std::string environmentName;
+        std::string allDirectionsEnvironmentName;
+        std::vector<DifficultyBeatmapSetInfo> difficultyBeatmapSets;
+
+        /// @brief Difficulty files of all sets in the order they get hashed
+        std::vector<std::string> GetDifficultyFiles() const;
+    };
+
+    /// @brief Gets the path of the info.dat of a song folder, prefers info.dat over Info.dat
+    std::string GetInfoPath(std::string const& customLevelPath);
+
+    /// @brief Reads the info.dat of a song folder or zipped song as it is on disk
+    /// @return Empty if there is none
+    std::string ReadInfoText(std::string const& customLevelPath);
+
+    /// @brief Parses an info.dat without touching il2cpp
+    std::optional<LevelInfo> Parse(std::string_view json);
+
+    /// @brief Reads and parses the info.dat of a song folder or zipped song without touching il2cpp
+    std::optional<LevelInfo> Read(std::string const& customLevelPath);
+
+}
@@ -5,4 +5,10 @@ namespace RuntimeSongLoader::OggVorbisUtils {
     
     float GetLengthFromOggVorbisFile(std::string_view path);
 
+    /// @brief Same as GetLengthFromOggVorbisFile for audio that is already in memory, like a member of a zipped song
+    float GetLengthFromOggVorbisData(const char* data, size_t dataLength);
+
+    /// @brief Gets the length of the audio of a song folder or zipped song, the audio of zips is probed in memory
+    float GetLengthFromLevelAudio(std::string const& customLevelPath, std::string_view songFilename);
+
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+#include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
+#include "GlobalNamespace/EnvironmentInfoSO.hpp"
+
+#include <string_view>
+
+namespace RuntimeSongLoader::ResolveUtils {
+
+    /// @brief Finds a characteristic by serialized name in a native map, falls back to MissingCharacteristic
+    GlobalNamespace::BeatmapCharacteristicSO* GetBeatmapCharacteristic(StringW serializedName);
+    GlobalNamespace::BeatmapCharacteristicSO* GetBeatmapCharacteristic(std::string_view serializedName);
+
+    /// @brief Finds an environment by serialized name in a native map, nullptr if there is none
+    GlobalNamespace::EnvironmentInfoSO* GetEnvironmentInfo(StringW serializedName);
+    GlobalNamespace::EnvironmentInfoSO* GetEnvironmentInfo(std::string_view serializedName);
+
+    /// @brief Rebuilds the maps from the CustomLevelLoader on next use
+    void Invalidate();
+
+}
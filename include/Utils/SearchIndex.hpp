@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace RuntimeSongLoader::SearchUtils {
+
+    /// @brief Separates the indexed fields inside a document so no bigram or trigram spans two fields
+    constexpr char16_t FieldSeparator = u'\n';
+
+    /// @brief Native bigram and trigram index over case folded texts, doesn't touch il2cpp and isn't thread safe
+    /// Documents are identified by an opaque key, SearchUtils uses the level pointers
+    class SearchIndex {
+        private:
+            struct Document {
+                const void* key = nullptr;
+                std::u16string text;
+            };
+
+            std::vector<Document> documents;
+            std::vector<uint32_t> freeDocuments;
+            std::unordered_map<const void*, uint32_t> documentIds;
+            // Sorted document ids by bigram or trigram key
+            std::unordered_map<uint64_t, std::vector<uint32_t>> postings;
+
+            void RemoveDocument(uint32_t id);
+
+        public:
+            /// @brief Adds or replaces the document of key
+            /// @param text Case folded fields separated by FieldSeparator
+            void Add(const void* key, std::u16string text);
+
+            void Remove(const void* key);
+
+            /// @brief Removes every document whose key isn't in keys
+            void RemoveExcept(std::unordered_set<const void*> const& keys);
+
+            bool Contains(const void* key) const;
+
+            void Clear();
+
+            std::size_t GetDocumentsCount() const;
+
+            /// @brief Distinct bigrams and trigrams of all documents
+            std::size_t GetKeysCount() const;
+
+            /// @brief Finds the documents containing the query, in no particular order
+            /// @param foldedQuery Case folded like the documents
+            /// @param prefixOnly If the query has to match the start of a word instead of any substring
+            std::vector<const void*> Search(std::u16string_view foldedQuery, bool prefixOnly) const;
+    };
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp"
+
+#include <string>
+#include <vector>
+
+namespace RuntimeSongLoader::SearchUtils {
+
+    void AddLevel(GlobalNamespace::CustomPreviewBeatmapLevel* level);
+
+    void RemoveLevel(GlobalNamespace::CustomPreviewBeatmapLevel* level);
+
+    void SetLevels(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const& levels);
+
+    void Clear();
+
+    std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> Search(std::string_view query, bool prefixOnly);
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RuntimeSongLoader::SnapshotUtils {
+
+    /// @brief Everything needed to create a level without touching its folder
+    struct SnapshotLevel {
+        std::string path;
+        bool wip = false;
+        std::string hash;
+        int directoryHash = 0;
+        float songDuration = 0.0f;
+        /// @brief The info.dat as it is on disk
+        std::string infoText;
+    };
+
+    /// @brief Reads the levels of the last committed library in their order
+    /// @return Empty if there is no snapshot or it can't be read
+    std::vector<SnapshotLevel> Load(std::string_view path);
+
+    /// @brief Writes the levels in their order
+    /// An empty infoText is taken from the previous snapshot if the folder didn't change, otherwise it's read from disk
+    /// Concurrent saves run one after another
+    bool Save(std::string_view path, std::vector<SnapshotLevel> levels);
+
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+namespace RuntimeSongLoader::StringUtils {
+
+    std::u16string FoldCase(std::u16string_view text);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace RuntimeSongLoader::ThreadUtils {
+
+    /// @brief Lowers the scheduling priority of the calling thread and optionally pins it to the efficiency cores
+    /// Raising the priority again needs privileges apps don't have, so only use it on threads that end afterwards
+    /// @param niceness Nice value, higher is lower priority
+    /// @param efficiencyCoresOnly Pins to the cores with the lowest max frequency, nothing happens if all cores are equal
+    void LowerCurrentThreadPriority(int niceness, bool efficiencyCoresOnly);
+
+    /// @brief Paces work so it uses at most a share of a core and a number of bytes per second
+    /// Safe to share between threads, the byte limit applies to all of them together
+    class Throttle {
+        private:
+            float cpuShare;
+            uint64_t maxBytesPerSecond;
+            std::mutex mutex;
+            std::chrono::steady_clock::time_point nextBytesAvailable;
+
+        public:
+            /// @param cpuShare Share of a core per thread, 1 or more doesn't limit
+            /// @param maxBytesPerSecond 0 doesn't limit
+            Throttle(float cpuShare, uint64_t maxBytesPerSecond);
+
+            /// @brief Sleeps after work that took workTime and read bytes until the limits are met again
+            void Pace(std::chrono::steady_clock::duration workTime, uint64_t bytes);
+    };
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RuntimeSongLoader::ZipUtils {
+
+    /// @brief Zipped songs in the song folders are loaded like folders
+    inline constexpr std::string_view ArchiveExtension = ".zip";
+
+    /// @brief If path is a zipped song, a regular file with the archive extension
+    /// Only paths with the extension get stat'ed, folders named like zips are loaded as folders
+    bool IsArchivePath(std::string_view path);
+
+    struct ZipEntry {
+        /// @brief Relative to the folder of the info.dat, some zips wrap the song in a folder
+        std::string name;
+        uint16_t method = 0;
+        uint32_t crc32 = 0;
+        uint32_t compressedSize = 0;
+        uint32_t size = 0;
+        uint32_t localHeaderOffset = 0;
+    };
+
+    /// @brief Central directory of a zip, read once on Open
+    /// Members are inflated on demand straight from the archive, nothing is kept open in between
+    class ZipArchive {
+        private:
+            std::string path;
+            std::vector<ZipEntry> entries;
+            uint64_t fileSize = 0;
+            int64_t lastWriteTime = 0;
+
+            /// @brief Inflates the member in chunks, output gets every chunk and returns false to stop
+            bool Inflate(ZipEntry const& entry, std::function<bool(const char*, std::size_t)> const& output) const;
+
+        public:
+            /// @return nullptr if path isn't a readable zip
+            static std::shared_ptr<ZipArchive> Open(std::string const& path);
+
+            std::string const& GetPath() const {
+                return path;
+            }
+
+            uint64_t GetFileSize() const {
+                return fileSize;
+            }
+
+            /// @brief Seconds since the epoch
+            int64_t GetLastWriteTime() const {
+                return lastWriteTime;
+            }
+
+            std::vector<ZipEntry> const& GetEntries() const {
+                return entries;
+            }
+
+            /// @brief Finds a member, falls back to ignoring the case like the sdcard does for song folders
+            ZipEntry const* Find(std::string_view name) const;
+
+            /// @brief Inflates a member into memory and checks its CRC
+            /// @return nullopt if the member doesn't exist or is corrupted
+            std::optional<std::string> Read(std::string_view name) const;
+
+            /// @brief Inflates a member into a new file, written next to it first so it never exists half written
+            bool Extract(std::string_view name, std::string const& destinationPath) const;
+    };
+
+    /// @brief Opens an archive or returns the one opened before if the file didn't change since
+    std::shared_ptr<ZipArchive> GetArchive(std::string const& path);
+
+    /// @brief Same role as HashUtils::GetDirectoryHash for folders, changes with the archive's size and time
+    std::optional<int> GetArchiveHash(std::string const& path);
+
+    /// @brief Reads a file of a song, from its folder or from inside its zip
+    /// @return nullopt if the file doesn't exist
+    std::optional<std::string> ReadLevelFile(std::string const& customLevelPath, std::string_view name);
+
+    /// @brief Gets a path on disk for a file of a song, members of zips get extracted into the extraction folder first (blocking)
+    /// @return nullopt if the file doesn't exist or can't be extracted
+    std::optional<std::string> ExtractLevelFile(std::string const& customLevelPath, std::string_view name);
+
+    /// @brief If ExtractLevelFile already extracted the member from the current version of the zip, only stats the zip
+    bool IsLevelFileExtracted(std::string const& customLevelPath, std::string_view name);
+
+    /// @brief Maps a path into a zipped song like Song.zip/song.egg to its extracted copy, never extracts
+    /// @return nullopt if filePath isn't inside a zip or ExtractLevelFile didn't extract the member yet
+    std::optional<std::string> ResolveArchiveFilePath(std::string_view filePath);
+
+    /// @brief Moves the files extracted from zips by earlier sessions into the trash, has to run before anything gets extracted
+    void ClearExtractedFiles();
+
+}
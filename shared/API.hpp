@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp"
 #include "GlobalNamespace/StandardLevelInfoSaveData.hpp"
@@ -9,14 +12,114 @@
 #include "CustomTypes/SongLoaderBeatmapLevelPackCollectionSO.hpp"
 #include "CustomTypes/CustomLevelInfoSaveData.hpp"
 
+namespace RuntimeSongLoader {
+
+    /// @brief Identifies an added event callback, can be used to remove it again
+    using EventHandle = uint64_t;
+
+    /// @brief Upper limits in microseconds of the event latency histogram buckets, the last bucket has no limit
+    constexpr std::array<uint64_t, 7> EventLatencyBucketLimits = { 100, 500, 1000, 5000, 10000, 50000, 100000 };
+    constexpr std::size_t EventLatencyBucketsCount = EventLatencyBucketLimits.size() + 1;
+
+    /// @brief Timings of a single event callback
+    struct EventSubscriberStats {
+        std::string event;
+        /// @brief Owner tag given when adding the callback, empty if there is none
+        std::string owner;
+        EventHandle handle = 0;
+        uint64_t calls = 0;
+        uint64_t totalMicroseconds = 0;
+        uint64_t maxMicroseconds = 0;
+        std::array<uint64_t, EventLatencyBucketsCount> latencyHistogram = {};
+    };
+
+    enum class SongOperationResult {
+        Success,
+        NotFound,
+        AlreadyLoaded,
+        Failed
+    };
+
+    struct LevelChange {
+        std::string path;
+        std::string levelID;
+        GlobalNamespace::CustomPreviewBeatmapLevel* level = nullptr;
+        /// @brief Only set for changed levels, the level that got replaced
+        GlobalNamespace::CustomPreviewBeatmapLevel* previousLevel = nullptr;
+    };
+
+    /// @brief Difference of the loaded levels before and after a refresh, add or delete
+    struct LevelsChangeSet {
+        std::vector<LevelChange> added;
+        std::vector<LevelChange> removed;
+        /// @brief Levels that got reloaded from the same path because their files changed, levelID is the new one
+        std::vector<LevelChange> changed;
+
+        bool Empty() const {
+            return added.empty() && removed.empty() && changed.empty();
+        }
+    };
+
+    /// @brief Memory saved by sharing repeating level data since the last full refresh
+    struct InternReport {
+        std::size_t internedStrings = 0;
+        /// @brief How often a loaded string was replaced with an interned one
+        std::size_t sharedStrings = 0;
+        std::size_t previewDifficultyBeatmapSetLists = 0;
+        std::size_t sharedPreviewDifficultyBeatmapSetLists = 0;
+        /// @brief Estimated size of the managed objects that didn't have to be kept
+        std::size_t bytesSaved = 0;
+    };
+
+    /// @brief Cost of the main thread work (committing levels, events) spread over frames
+    struct FrameWorkReport {
+        /// @brief Frames and steps of the current or last batch of work
+        uint64_t frames = 0;
+        uint64_t steps = 0;
+        uint64_t totalMicroseconds = 0;
+        /// @brief Most time spent in a single frame by the current or last batch
+        uint64_t worstFrameMicroseconds = 0;
+        /// @brief Most time spent in a single frame since the game started
+        uint64_t worstFrameMicrosecondsOverall = 0;
+        std::size_t pendingSteps = 0;
+    };
+
+    /// @brief How refreshes requested outside the menu scan the songs, their levels get committed once the menu is active
+    struct BackgroundScanOptions {
+        /// @brief If false refreshes outside the menu are ignored
+        bool enabled = true;
+        /// @brief Threads scanning song folders
+        int threads = 2;
+        /// @brief Nice value of the scanning threads, higher is lower priority
+        int niceness = 10;
+        /// @brief Pins the scanning threads to the cores with the lowest max frequency
+        bool efficiencyCoresOnly = true;
+        /// @brief Share of a core every scanning thread may use, 1 doesn't limit
+        float cpuShare = 0.25f;
+        /// @brief Bytes of song data files read per second by all threads, 0 doesn't limit
+        uint64_t maxBytesPerSecond = 4 * 1024 * 1024;
+    };
+
+    /// @brief Result of a single path passed to AddSongs or DeleteSongs
+    struct SongOperationStatus {
+        std::string path;
+        SongOperationResult result = SongOperationResult::Failed;
+        /// @brief The added or removed level, nullptr if there is none
+        GlobalNamespace::CustomPreviewBeatmapLevel* level = nullptr;
+    };
+
+}
+
 namespace RuntimeSongLoader::API {
 
-    /// @brief Loads Songs on disk. This will reload already loaded songs
+    /// @brief Loads Songs on disk with a full refresh
+    /// Already loaded songs are checked against their folders, only the changed ones get reloaded and the unchanged ones keep their objects
     void RefreshSongs();
     
     /// @brief Loads Songs on disk
-    /// @tparam fullRefresh If it should reload already loaded songs
+    /// @tparam fullRefresh If it should check already loaded songs against their folders and reload the changed ones
     /// @tparam songsLoaded gets called after songs got loaded
+    /// Requests while songs are loading or in quick succession are merged into one refresh, every songsLoaded still gets called once
     void RefreshSongs(bool fullRefresh, std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& songsLoaded = nullptr);
 
     /// @brief Loads Packs on disk
@@ -25,28 +128,86 @@ namespace RuntimeSongLoader::API {
 
     /// @brief Add a loading callback that gets called after songs got loaded
     /// @tparam event Callback event
-    void AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event);
+    /// @return Handle to remove the callback with RemoveSongsLoadedEvent
+    EventHandle AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event);
+
+    /// @tparam owner Tag of the mod adding the callback, shown in the event stats and slow callback warnings
+    EventHandle AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event, std::string_view owner);
 
     /// @brief Add a callback that gets called before level packs get refreshed
+    /// Called on every refresh, the packs are only committed to the game afterwards if they or the packs added by callbacks changed
     /// @tparam event Callback event
-    void AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event);
+    /// @return Handle to remove the callback with RemoveRefreshLevelPacksEvent
+    EventHandle AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event);
+
+    EventHandle AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event, std::string_view owner);
 
     /// @brief Add a callback that gets called after it tried to load a BeatmapData
     /// @tparam event Callback event
-    void AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event);
+    /// @return Handle to remove the callback with RemoveBeatmapDataBasicInfoLoadedEvent
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event);
+
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event, std::string_view owner);
     
     /// @brief Add a callback that gets called when a song is deleted
     /// @tparam event Callback event
-    void AddSongDeletedEvent(std::function<void()> const& event);
+    /// @return Handle to remove the callback with RemoveSongDeletedEvent
+    EventHandle AddSongDeletedEvent(std::function<void()> const& event);
+
+    EventHandle AddSongDeletedEvent(std::function<void()> const& event, std::string_view owner);
+
+    /// @brief Add a callback that gets called when a song is deleted
+    /// @tparam event Callback event with the removed level (nullptr if it wasn't loaded)
+    /// @return Handle to remove the callback with RemoveSongDeletedEvent
+    EventHandle AddSongDeletedEvent(std::function<void(GlobalNamespace::CustomPreviewBeatmapLevel*)> const& event);
+
+    EventHandle AddSongDeletedEvent(std::function<void(GlobalNamespace::CustomPreviewBeatmapLevel*)> const& event, std::string_view owner);
+
+    /// @brief Add a callback that gets called with the added, removed and changed levels after songs got loaded, added or deleted
+    /// @tparam event Callback event
+    /// @return Handle to remove the callback with RemoveLevelsChangedEvent
+    EventHandle AddLevelsChangedEvent(std::function<void(LevelsChangeSet const&)> const& event);
+
+    EventHandle AddLevelsChangedEvent(std::function<void(LevelsChangeSet const&)> const& event, std::string_view owner);
+
+    /// @brief Removes a callback, it is safe to call this from inside a callback
+    /// @tparam handle Handle returned when adding the callback
+    /// @return If the callback was found
+    bool RemoveSongsLoadedEvent(EventHandle handle);
+
+    bool RemoveRefreshLevelPacksEvent(EventHandle handle);
+
+    bool RemoveBeatmapDataBasicInfoLoadedEvent(EventHandle handle);
 
-    /// @brief Delets a song on filesystem (doesn't refresh songs)
+    bool RemoveSongDeletedEvent(EventHandle handle);
+
+    bool RemoveLevelsChangedEvent(EventHandle handle);
+
+    /// @brief Gets call counts and latencies of every added event callback
+    std::vector<EventSubscriberStats> GetEventStats();
+
+    /// @brief Callbacks taking at least this long get logged as a warning
+    /// @tparam microseconds Threshold, 0 disables the warning
+    void SetEventWarningThreshold(uint64_t microseconds);
+
+    /// @brief Delets a song on filesystem and removes it from the loaded songs and packs (no refresh needed)
     /// @tparam path Path to the song on filesystem
     /// @tparam finished Callback once done
     void DeleteSong(std::string_view path, std::function<void()> const& finished = nullptr);
+
+    /// @brief Delets songs on filesystem in parallel and removes them from the game in one commit
+    /// @tparam paths Paths to the songs on filesystem
+    /// @tparam finished Callback with the result of every path once done
+    void DeleteSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished = nullptr);
+
+    /// @brief Loads new song folders in parallel and adds them to the game in one commit (no full refresh needed)
+    /// @tparam paths Paths to the song folders, inside CustomWIPLevels they are added as WIP levels
+    /// @tparam finished Callback with the result of every path once done
+    void AddSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished = nullptr);
     
     std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLoadedSongs();
 
-    /// @brief If songs did get loaded
+    /// @brief If songs did get loaded, only set once the loaded callbacks and events of a refresh ran
     bool HasLoadedSongs();
 
     /// @brief gets how far along the loading progress the songloader is
@@ -56,6 +217,31 @@ namespace RuntimeSongLoader::API {
     
     std::optional<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLevelById(std::string_view levelID);
 
+    /// @brief Gets the save data of a loaded level as CustomLevelInfoSaveData, it is parsed together with the level
+    /// @tparam level Level to get the save data of
+    /// @return nullptr if the level has no custom save data
+    CustomJSONData::CustomLevelInfoSaveData* GetStandardLevelInfoSaveData(GlobalNamespace::CustomPreviewBeatmapLevel* level);
+
+    /// @brief Searches the loaded songs by song name, sub name, song author and level author (case insensitive)
+    /// @tparam query Text to search for
+    /// @tparam prefixOnly If the query has to match the start of a word instead of any substring
+    std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> SearchLevels(std::string_view query, bool prefixOnly = false);
+
+    /// @brief Gets how much memory is saved by sharing strings and difficulty sets between levels
+    InternReport GetInternReport();
+
+    /// @brief Gets how many frames committing the last refresh took and the worst frame it caused
+    FrameWorkReport GetFrameWorkReport();
+
+    /// @brief Main thread time per frame that committing levels may use, at least one step runs every frame
+    /// @tparam microseconds Budget per frame
+    void SetFrameBudget(uint64_t microseconds);
+
+    /// @brief Sets how refreshes outside the menu scan in the background
+    void SetBackgroundScanOptions(BackgroundScanOptions const& options);
+
+    BackgroundScanOptions GetBackgroundScanOptions();
+
     std::string GetCustomLevelsPrefix();
 
     std::string GetCustomLevelPacksPrefix();
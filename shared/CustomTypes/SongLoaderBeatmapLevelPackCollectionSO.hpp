@@ -9,6 +9,10 @@ DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoaderBeatmapLevelPackCollectionSO,
  
     private:
         DECLARE_INSTANCE_FIELD(List<GlobalNamespace::CustomBeatmapLevelPack*>*, customBeatmapLevelPacks);
+        DECLARE_INSTANCE_FIELD(int, updateDepth);
+        DECLARE_INSTANCE_FIELD(bool, isDirty);
+
+        bool IsArrayUpToDate();
 
     public:
         static SongLoaderBeatmapLevelPackCollectionSO* CreateNew();
@@ -17,6 +21,11 @@ DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoaderBeatmapLevelPackCollectionSO,
         void ClearLevelPacks();
         void UpdateArray();
 
+        /// @brief Defers UpdateArray until the matching EndUpdate
+        void BeginUpdate();
+        /// @brief Returns true if the packs array changed during the update
+        bool EndUpdate();
+
     DECLARE_CTOR(ctor);
 
 )
\ No newline at end of file
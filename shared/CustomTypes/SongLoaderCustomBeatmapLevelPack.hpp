@@ -1,20 +1,61 @@
-#pragma once 
+#pragma once
 #include "beatsaber-hook/shared/utils/typedefs.h"
 
-#include "custom-types/shared/macros.hpp" 
+#include "custom-types/shared/macros.hpp"
 
 #include "SongLoaderBeatmapLevelPackCollectionSO.hpp"
 
-#include "GlobalNamespace/CustomBeatmapLevelPack.hpp" 
-#include "GlobalNamespace/CustomBeatmapLevelCollection.hpp" 
-#include "UnityEngine/Sprite.hpp" 
- 
+#include "GlobalNamespace/CustomBeatmapLevelPack.hpp"
+#include "GlobalNamespace/CustomBeatmapLevelCollection.hpp"
+#include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp"
+#include "UnityEngine/Sprite.hpp"
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace RuntimeSongLoader {
+
+    enum class SortMode {
+        SongName,
+        DateAdded,
+        Duration,
+        BeatsPerMinute,
+        LevelAuthor
+    };
+
+    constexpr std::size_t SortModesCount = 5;
+
+    struct LevelSortKey {
+        GlobalNamespace::CustomPreviewBeatmapLevel* level = nullptr;
+        std::u16string songName;
+        std::u16string levelAuthorName;
+        int64_t dateAdded = 0;
+        float songDuration = 0.0f;
+        float beatsPerMinute = 0.0f;
+    };
+
+}
+
 DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoaderCustomBeatmapLevelPack, Il2CppObject,
-    
+
     DECLARE_INSTANCE_FIELD(GlobalNamespace::CustomBeatmapLevelCollection*, CustomLevelsCollection);
     DECLARE_INSTANCE_FIELD(GlobalNamespace::CustomBeatmapLevelPack*, CustomLevelsPack);
 
     DECLARE_CTOR(ctor, StringW packID, StringW packName, UnityEngine::Sprite* coverImage = nullptr);
+    DECLARE_SIMPLE_DTOR();
+
+    private:
+        std::mutex sortMutex;
+        // Native keys, one per level in the collection (unordered)
+        std::vector<LevelSortKey> sortKeys;
+        // Indices into sortKeys for every SortMode, kept sorted
+        std::array<std::vector<uint32_t>, SortModesCount> orderings;
+        // Set when the levels changed since the pack was last committed to the game
+        bool isDirty = false;
+
+        ArrayW<GlobalNamespace::CustomPreviewBeatmapLevel*> GetSortedLevelsUnsafe(SortMode mode);
 
     public:
         static SongLoaderCustomBeatmapLevelPack* Make_New(std::string const& packID, std::string_view packName, UnityEngine::Sprite* coverImage = nullptr);
@@ -22,8 +63,15 @@ DECLARE_CLASS_CODEGEN(RuntimeSongLoader, SongLoaderCustomBeatmapLevelPack, Il2Cp
         ArrayW<GlobalNamespace::CustomPreviewBeatmapLevel*> GetCustomPreviewBeatmapLevels();
         void SetCustomPreviewBeatmapLevels(ArrayW<GlobalNamespace::CustomPreviewBeatmapLevel*> customPreviewBeatmapLevels);
 
+        /// @brief Gets the levels of this pack ordered by mode, the orderings are precomputed when levels are set
+        ArrayW<GlobalNamespace::CustomPreviewBeatmapLevel*> GetSortedLevels(SortMode mode);
+
+        /// @brief Does nothing, the levels are sorted by song name when they are set
         void SortLevels();
-        
+
+        bool IsDirty();
+        void ClearDirty();
+
         void AddTo(SongLoaderBeatmapLevelPackCollectionSO* customBeatmapLevelPackCollectionSO, bool addIfEmpty = false);
 
 )
\ No newline at end of file
@@ -4,6 +4,9 @@
 
 #include "CustomTypes/SongLoader.hpp"
 #include "CustomBeatmapLevelLoader.hpp"
+#include "Utils/SearchUtils.hpp"
+#include "Utils/EventList.hpp"
+#include "Utils/InternUtils.hpp"
 
 namespace RuntimeSongLoader::API {
 
@@ -19,26 +22,97 @@ namespace RuntimeSongLoader::API {
         SongLoader::GetInstance()->RefreshLevelPacks(includeDefault);
     }
 
-    void AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event) {
-        SongLoader::AddSongsLoadedEvent(event);
+    EventHandle AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event) {
+        return SongLoader::AddSongsLoadedEvent(event, "");
     }
 
-    void AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event) {
-        SongLoader::AddRefreshLevelPacksEvent(event);
+    EventHandle AddSongsLoadedEvent(std::function<void(std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> const&)> const& event, std::string_view owner) {
+        return SongLoader::AddSongsLoadedEvent(event, owner);
     }
 
-    void AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event) {
-        CustomBeatmapLevelLoader::AddBeatmapDataBasicInfoLoadedEvent(event);
+    EventHandle AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event) {
+        return SongLoader::AddRefreshLevelPacksEvent(event, "");
     }
 
-    void AddSongDeletedEvent(std::function<void()> const& event) {
-        SongLoader::AddSongDeletedEvent(event);
+    EventHandle AddRefreshLevelPacksEvent(std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)> const& event, std::string_view owner) {
+        return SongLoader::AddRefreshLevelPacksEvent(event, owner);
+    }
+
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event) {
+        return CustomBeatmapLevelLoader::AddBeatmapDataBasicInfoLoadedEvent(event, "");
+    }
+
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveDataVersion3::BeatmapSaveData*, GlobalNamespace::BeatmapDataBasicInfo*)> const& event, std::string_view owner) {
+        return CustomBeatmapLevelLoader::AddBeatmapDataBasicInfoLoadedEvent(event, owner);
+    }
+
+    EventHandle AddSongDeletedEvent(std::function<void()> const& event) {
+        return SongLoader::AddSongDeletedEvent(event, "");
+    }
+
+    EventHandle AddSongDeletedEvent(std::function<void()> const& event, std::string_view owner) {
+        return SongLoader::AddSongDeletedEvent(event, owner);
+    }
+
+    EventHandle AddSongDeletedEvent(std::function<void(GlobalNamespace::CustomPreviewBeatmapLevel*)> const& event) {
+        return SongLoader::AddSongDeletedEvent(event, "");
+    }
+
+    EventHandle AddSongDeletedEvent(std::function<void(GlobalNamespace::CustomPreviewBeatmapLevel*)> const& event, std::string_view owner) {
+        return SongLoader::AddSongDeletedEvent(event, owner);
+    }
+
+    EventHandle AddLevelsChangedEvent(std::function<void(LevelsChangeSet const&)> const& event) {
+        return SongLoader::AddLevelsChangedEvent(event, "");
+    }
+
+    EventHandle AddLevelsChangedEvent(std::function<void(LevelsChangeSet const&)> const& event, std::string_view owner) {
+        return SongLoader::AddLevelsChangedEvent(event, owner);
+    }
+
+    bool RemoveSongsLoadedEvent(EventHandle handle) {
+        return SongLoader::RemoveSongsLoadedEvent(handle);
+    }
+
+    bool RemoveRefreshLevelPacksEvent(EventHandle handle) {
+        return SongLoader::RemoveRefreshLevelPacksEvent(handle);
+    }
+
+    bool RemoveBeatmapDataBasicInfoLoadedEvent(EventHandle handle) {
+        return CustomBeatmapLevelLoader::RemoveBeatmapDataBasicInfoLoadedEvent(handle);
+    }
+
+    bool RemoveSongDeletedEvent(EventHandle handle) {
+        return SongLoader::RemoveSongDeletedEvent(handle);
+    }
+
+    bool RemoveLevelsChangedEvent(EventHandle handle) {
+        return SongLoader::RemoveLevelsChangedEvent(handle);
+    }
+
+    std::vector<EventSubscriberStats> GetEventStats() {
+        std::vector<EventSubscriberStats> stats;
+        for(auto eventList : EventListBase::GetEventLists())
+            eventList->AppendStats(stats);
+        return stats;
+    }
+
+    void SetEventWarningThreshold(uint64_t microseconds) {
+        EventWarningThresholdMicroseconds = microseconds;
     }
 
     void DeleteSong(std::string_view path, std::function<void()> const& finished) {
         SongLoader::GetInstance()->DeleteSong(path, finished);
     }
 
+    void DeleteSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished) {
+        SongLoader::GetInstance()->DeleteSongs(paths, finished);
+    }
+
+    void AddSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished) {
+        SongLoader::GetInstance()->AddSongs(paths, finished);
+    }
+
     std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLoadedSongs() {
         return SongLoader::GetInstance()->GetLoadedLevels();
     }
@@ -55,21 +129,43 @@ namespace RuntimeSongLoader::API {
 
     std::optional<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLevelByHash(std::string hash) {
         std::transform(hash.begin(), hash.end(), hash.begin(), toupper);
-        for(auto& song : RuntimeSongLoader::API::GetLoadedSongs()) {
-            if(song->levelID.ends_with(hash))
-                return song;
-        }
-        return std::nullopt;
+        return GetLevelById(CustomLevelPrefixID + hash);
     }
 
     std::optional<GlobalNamespace::CustomPreviewBeatmapLevel*> GetLevelById(std::string_view levelID) {
-        for(auto& song : RuntimeSongLoader::API::GetLoadedSongs()) {
-            if(song->levelID == levelID)
-                return song;
-        }
+        if(auto level = SongLoader::GetInstance()->GetLevelById(levelID))
+            return level;
         return std::nullopt;
     }
 
+    CustomJSONData::CustomLevelInfoSaveData* GetStandardLevelInfoSaveData(GlobalNamespace::CustomPreviewBeatmapLevel* level) {
+        return SongLoader::GetInstance()->LoadStandardLevelInfoSaveData(level);
+    }
+
+    std::vector<GlobalNamespace::CustomPreviewBeatmapLevel*> SearchLevels(std::string_view query, bool prefixOnly) {
+        return SearchUtils::Search(query, prefixOnly);
+    }
+
+    InternReport GetInternReport() {
+        return InternUtils::GetReport();
+    }
+
+    FrameWorkReport GetFrameWorkReport() {
+        return SongLoader::GetInstance()->GetCommitQueue().GetReport();
+    }
+
+    void SetFrameBudget(uint64_t microseconds) {
+        SongLoader::GetInstance()->GetCommitQueue().SetBudget(microseconds);
+    }
+
+    void SetBackgroundScanOptions(BackgroundScanOptions const& options) {
+        SongLoader::SetBackgroundScanOptions(options);
+    }
+
+    BackgroundScanOptions GetBackgroundScanOptions() {
+        return SongLoader::GetBackgroundScanOptions();
+    }
+
     std::string GetCustomLevelsPrefix() {
         return CustomLevelPrefixID;
     }
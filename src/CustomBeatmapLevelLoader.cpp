@@ -4,9 +4,14 @@
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
 
 #include "CustomLogger.hpp"
+#include "LoadScheduler.hpp"
+
+#include "CustomTypes/SongLoader.hpp"
 
-#include "Utils/FileUtils.hpp"
 #include "Utils/FindComponentsUtils.hpp"
+#include "Utils/EventList.hpp"
+#include "Utils/ResolveUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 #include "questui/shared/CustomTypes/Components/MainThreadScheduler.hpp"
 
 #include "GlobalNamespace/FileHelpers.hpp"
@@ -20,6 +25,7 @@
 #include "GlobalNamespace/CustomDifficultyBeatmap.hpp"
 #include "GlobalNamespace/CustomDifficultyBeatmapSet.hpp"
 #include "GlobalNamespace/IDifficultyBeatmapSet.hpp"
+#include "GlobalNamespace/IPreviewBeatmapLevel.hpp"
 #include "GlobalNamespace/BeatmapDifficulty.hpp"
 #include "GlobalNamespace/BeatmapDifficultySerializedMethods.hpp"
 #include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
@@ -35,6 +41,7 @@
 #include "UnityEngine/Networking/DownloadHandlerAudioClip.hpp"
 #include "UnityEngine/AudioType.hpp"
 #include "UnityEngine/AudioClip.hpp"
+#include "UnityEngine/Sprite.hpp"
 #include "System/Action.hpp"
 #include "System/Collections/Generic/Dictionary_2.hpp"
 #include "System/IO/Path.hpp"
@@ -44,6 +51,7 @@
 
 #include <vector>
 #include <mutex>
+#include <atomic>
 
 using namespace GlobalNamespace;
 using namespace BeatmapSaveDataVersion3;
@@ -57,25 +65,25 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
 
     using namespace FindComponentsUtils;
 
-    std::vector<std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveData*, BeatmapDataBasicInfo*)>> BeatmapDataBasicInfoLoadedEvents;
-    std::mutex BeatmapDataBasicInfoLoadedEventsMutex;
+    EventList<CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveData*, BeatmapDataBasicInfo*> BeatmapDataBasicInfoLoadedEvents("BeatmapDataBasicInfoLoaded");
+
+    EventHandle AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveData*, BeatmapDataBasicInfo*)> const& event, std::string_view owner) {
+        return BeatmapDataBasicInfoLoadedEvents.Add(event, owner);
+    }
 
-    void AddBeatmapDataBasicInfoLoadedEvent(std::function<void(CustomJSONData::CustomLevelInfoSaveData*, std::string const&, BeatmapSaveData*, BeatmapDataBasicInfo*)> const& event) {
-        std::lock_guard<std::mutex> lock(BeatmapDataBasicInfoLoadedEventsMutex);
-        BeatmapDataBasicInfoLoadedEvents.push_back(event);
+    bool RemoveBeatmapDataBasicInfoLoadedEvent(EventHandle handle) {
+        return BeatmapDataBasicInfoLoadedEvents.Remove(handle);
     }
     
     bool LoadBeatmapDataBasicInfo(std::string const& customLevelPath, std::string const& difficultyFileName, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, BeatmapSaveData*& beatmapSaveData, BeatmapDataBasicInfo*& beatmapDataBasicInfo) {
         LOG_DEBUG("LoadBeatmapDataBasicInfo Start");
         std::string path = customLevelPath + "/" + difficultyFileName;
-        if(fileexists(path)) {
+        // Members of zipped songs are inflated in memory
+        if(auto text = ZipUtils::ReadLevelFile(customLevelPath, difficultyFileName)) {
             try {
-                beatmapSaveData = BeatmapSaveData::DeserializeFromJSONString(FileUtils::ReadAllText16(path));
+                beatmapSaveData = BeatmapSaveData::DeserializeFromJSONString(StringW(*text));
                 beatmapDataBasicInfo = BeatmapDataLoader::GetBeatmapDataBasicInfoFromSaveData(beatmapSaveData);
-                std::lock_guard<std::mutex> lock(BeatmapDataBasicInfoLoadedEventsMutex);
-                for (auto& event : BeatmapDataBasicInfoLoadedEvents) {
-                    event(standardLevelInfoSaveData, difficultyFileName, beatmapSaveData, beatmapDataBasicInfo);
-                }
+                BeatmapDataBasicInfoLoadedEvents.Invoke(standardLevelInfoSaveData, difficultyFileName, beatmapSaveData, beatmapDataBasicInfo);
                 return true;
             } catch(const std::runtime_error& e) {
                 LOG_ERROR("LoadBeatmapDataBasicInfo Can't Load File %s: %s!", (path).c_str(), e.what());
@@ -103,7 +111,7 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
     IDifficultyBeatmapSet* LoadDifficultyBeatmapSet(std::string const& customLevelPath, CustomBeatmapLevel* customBeatmapLevel, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, StandardLevelInfoSaveData::DifficultyBeatmapSet* difficultyBeatmapSetSaveData) {
         LOG_DEBUG("LoadDifficultyBeatmapSetAsync Start");
         if(!GetCustomLevelLoader()->beatmapCharacteristicCollection || !difficultyBeatmapSetSaveData || !difficultyBeatmapSetSaveData->beatmapCharacteristicName || !difficultyBeatmapSetSaveData->difficultyBeatmaps) return nullptr;
-        BeatmapCharacteristicSO* beatmapCharacteristicBySerializedName = GetCustomLevelLoader()->beatmapCharacteristicCollection->GetBeatmapCharacteristicBySerializedName(difficultyBeatmapSetSaveData->beatmapCharacteristicName);
+        BeatmapCharacteristicSO* beatmapCharacteristicBySerializedName = ResolveUtils::GetBeatmapCharacteristic(difficultyBeatmapSetSaveData->beatmapCharacteristicName);
         ArrayW<CustomDifficultyBeatmap*> difficultyBeatmaps = ArrayW<CustomDifficultyBeatmap*>(difficultyBeatmapSetSaveData->difficultyBeatmaps.Length());
         CustomDifficultyBeatmapSet* difficultyBeatmapSet = CustomDifficultyBeatmapSet::New_ctor(beatmapCharacteristicBySerializedName);
         for(int i = 0; i < difficultyBeatmapSetSaveData->difficultyBeatmaps.Length(); i++) {
@@ -137,6 +145,9 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
         ArrayW<IDifficultyBeatmapSet*> difficultyBeatmapSets = LoadDifficultyBeatmapSets(customLevelPath, customBeatmapLevel, standardLevelInfoSaveData);
         if(!difficultyBeatmapSets)
             return nullptr;
+        // The audio of zipped songs is extracted here, so the main thread doesn't wait for it
+        if(ZipUtils::IsArchivePath(customLevelPath) && standardLevelInfoSaveData->songFilename)
+            ZipUtils::ExtractLevelFile(customLevelPath, static_cast<std::string>(standardLevelInfoSaveData->songFilename));
         Task_1<AudioClip*>* task = nullptr;
         QuestUI::MainThreadScheduler::Schedule(
             [&] {
@@ -155,7 +166,9 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
 
     CustomBeatmapLevel* LoadCustomBeatmapLevel(CustomPreviewBeatmapLevel* customPreviewBeatmapLevel) {
         LOG_DEBUG("LoadCustomBeatmapLevel Start");
-        auto* standardLevelInfoSaveData = il2cpp_utils::cast<CustomJSONData::CustomLevelInfoSaveData>(customPreviewBeatmapLevel->standardLevelInfoSaveData);
+        auto* standardLevelInfoSaveData = SongLoader::GetInstance()->LoadStandardLevelInfoSaveData(customPreviewBeatmapLevel);
+        if(!standardLevelInfoSaveData)
+            return nullptr;
         CustomBeatmapLevel* customBeatmapLevel = CustomBeatmapLevel::New_ctor(customPreviewBeatmapLevel);
         BeatmapLevelData* beatmapLevelData = LoadBeatmapLevelData(customPreviewBeatmapLevel->customLevelPath, customBeatmapLevel, standardLevelInfoSaveData);
         if(!beatmapLevelData)
@@ -174,8 +187,9 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
                 LOG_DEBUG("BeatmapLevelsModel_GetBeatmapLevelAsync previewBeatmapLevel %p", previewBeatmapLevel);
                 if(il2cpp_functions::class_is_assignable_from(classof(CustomPreviewBeatmapLevel*), il2cpp_functions::object_get_class(reinterpret_cast<Il2CppObject*>(previewBeatmapLevel)))) {
                     auto task = Task_1<BeatmapLevelsModel::GetBeatmapLevelResult>::New_ctor();
-                    HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
-                        (std::function<void()>)[=] () mutable { 
+                    // Refreshes running meanwhile wait at their next folder, the player is waiting for this one
+                    LoadScheduler::Run(LoadPriority::Interactive,
+                        [=] () mutable { 
                             LOG_INFO("BeatmapLevelsModel_GetBeatmapLevelAsync Thread Start");
                             CustomBeatmapLevel* customBeatmapLevel = CustomBeatmapLevelLoader::LoadCustomBeatmapLevel(reinterpret_cast<CustomPreviewBeatmapLevel*>(previewBeatmapLevel));
                             auto result = BeatmapLevelsModel::GetBeatmapLevelResult(true, nullptr);
@@ -200,7 +214,7 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
                             }
                             LOG_INFO("BeatmapLevelsModel_GetBeatmapLevelAsync Thread Stop");
                         }
-                    ), nullptr)->Run();
+                    );
                     return task;
                 }
             }
@@ -209,8 +223,65 @@ namespace RuntimeSongLoader::CustomBeatmapLevelLoader {
         return result;
     }
 
+    /// @brief Runs load right away, unless it reads a file of a zipped song that isn't extracted yet
+    /// The file is then extracted on a worker first and load runs on the main thread after, so the main thread never waits for the zip
+    template<class T>
+    Task_1<T>* LoadLevelFile(CustomPreviewBeatmapLevel* level, StringW fileName, CancellationToken cancellationToken, std::function<Task_1<T>*()> const& load) {
+        std::string customLevelPath = static_cast<std::string>(level->customLevelPath);
+        if(!fileName || !ZipUtils::IsArchivePath(customLevelPath))
+            return load();
+        std::string name = static_cast<std::string>(fileName);
+        if(ZipUtils::IsLevelFileExtracted(customLevelPath, name))
+            return load();
+        auto task = Task_1<T>::New_ctor();
+        LoadScheduler::Run(LoadPriority::Interactive,
+            [=] {
+                ZipUtils::ExtractLevelFile(customLevelPath, name);
+                Task_1<T>* loadTask = nullptr;
+                std::atomic_bool started = false;
+                QuestUI::MainThreadScheduler::Schedule(
+                    [&] {
+                        try {
+                            loadTask = load();
+                        } catch (std::runtime_error const& e) {
+                            LOG_ERROR("LoadLevelFile Failed to load %s of %s: %s!", name.c_str(), customLevelPath.c_str(), e.what());
+                        }
+                        started = true;
+                    }
+                );
+                while(!started || (loadTask && !loadTask->get_IsCompleted())) {
+                    usleep(1 * 1000);
+                }
+                if(loadTask && loadTask->get_IsCanceled())
+                    task->TrySetCanceled(cancellationToken);
+                else
+                    task->TrySetResult(loadTask && !loadTask->get_IsFaulted() ? loadTask->get_Result() : nullptr);
+            }
+        );
+        return task;
+    }
+
+    MAKE_HOOK_MATCH(CustomPreviewBeatmapLevel_GetCoverImageAsync, &CustomPreviewBeatmapLevel::GetCoverImageAsync, Task_1<Sprite*>*, CustomPreviewBeatmapLevel* self, CancellationToken cancellationToken) {
+        auto standardLevelInfoSaveData = self->standardLevelInfoSaveData;
+        return LoadLevelFile<Sprite*>(self, standardLevelInfoSaveData ? standardLevelInfoSaveData->coverImageFilename : StringW(), cancellationToken,
+            [=] { return CustomPreviewBeatmapLevel_GetCoverImageAsync(self, cancellationToken); }
+        );
+    }
+
+    MAKE_HOOK_MATCH(AudioClipAsyncLoader_LoadPreview, &AudioClipAsyncLoader::LoadPreview, Task_1<AudioClip*>*, AudioClipAsyncLoader* self, IPreviewBeatmapLevel* previewLevel) {
+        if(!previewLevel || !il2cpp_functions::class_is_assignable_from(classof(CustomPreviewBeatmapLevel*), il2cpp_functions::object_get_class(reinterpret_cast<Il2CppObject*>(previewLevel))))
+            return AudioClipAsyncLoader_LoadPreview(self, previewLevel);
+        auto level = reinterpret_cast<CustomPreviewBeatmapLevel*>(previewLevel);
+        auto standardLevelInfoSaveData = level->standardLevelInfoSaveData;
+        return LoadLevelFile<AudioClip*>(level, standardLevelInfoSaveData ? standardLevelInfoSaveData->songFilename : StringW(), CancellationToken::get_None(),
+            [=] { return AudioClipAsyncLoader_LoadPreview(self, previewLevel); }
+        );
+    }
+
     void InstallHooks() {
         INSTALL_HOOK(getLogger(), BeatmapLevelsModel_GetBeatmapLevelAsync);
+        INSTALL_HOOK(getLogger(), CustomPreviewBeatmapLevel_GetCoverImageAsync);
+        INSTALL_HOOK(getLogger(), AudioClipAsyncLoader_LoadPreview);
     }
     
 }
\ No newline at end of file
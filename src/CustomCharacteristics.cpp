@@ -11,6 +11,8 @@
 
 #include "Sprites.hpp"
 
+#include "Utils/ResolveUtils.hpp"
+
 #include "GlobalNamespace/MainSystemInit.hpp"
 #include "GlobalNamespace/BeatmapCharacteristicCollectionSO.hpp"
 #include "UnityEngine/ScriptableObject.hpp"
@@ -32,6 +34,7 @@ using namespace UnityEngine;
 namespace RuntimeSongLoader::CustomCharacteristics {
 
     List<BeatmapCharacteristicSO*>* characteristicsList = nullptr;
+    BeatmapCharacteristicSO* missingCharacteristic = nullptr;
 
     BeatmapCharacteristicSO* RegisterCustomCharacteristic(Sprite *icon, StringW characteristicName, StringW hintText, StringW serializedName, StringW compoundIdPartName, bool requires360Movement, bool containsRotationEvents, int sortingOrder)
     {
@@ -61,6 +64,7 @@ namespace RuntimeSongLoader::CustomCharacteristics {
         characteristicsList->Add(characteristic);
         if(mainSystemInit)
             mainSystemInit->beatmapCharacteristicCollection->beatmapCharacteristics = characteristicsList->ToArray();
+        ResolveUtils::Invalidate();
 
         return characteristic;
     }
@@ -81,7 +85,7 @@ namespace RuntimeSongLoader::CustomCharacteristics {
     {
         BeatmapCharacteristicSO* result = BeatmapCharacteristicCollectionSO_GetBeatmapCharacteristicBySerializedName(self, serializedName);
         if(!result)
-            result = FindByName("MissingCharacteristic");
+            result = missingCharacteristic ? missingCharacteristic : FindByName("MissingCharacteristic");
         return result;
     }
 
@@ -94,7 +98,7 @@ namespace RuntimeSongLoader::CustomCharacteristics {
         if(!created) {
             created = true;
             
-            CustomCharacteristics::RegisterCustomCharacteristic(QuestUI::BeatSaberUI::Base64ToSprite(Sprites::CustomCharacteristics::MissingBase64), "Missing Characteristic", "Missing Characteristic", "MissingCharacteristic", "MissingCharacteristic", false, false, 1000);
+            missingCharacteristic = CustomCharacteristics::RegisterCustomCharacteristic(QuestUI::BeatSaberUI::Base64ToSprite(Sprites::CustomCharacteristics::MissingBase64), "Missing Characteristic", "Missing Characteristic", "MissingCharacteristic", "MissingCharacteristic", false, false, 1000);
             CustomCharacteristics::RegisterCustomCharacteristic(QuestUI::BeatSaberUI::Base64ToSprite(Sprites::CustomCharacteristics::LightshowBase64), "Lightshow", "Lightshow", "Lightshow", "Lightshow", false, false, 100);
             CustomCharacteristics::RegisterCustomCharacteristic(QuestUI::BeatSaberUI::Base64ToSprite(Sprites::CustomCharacteristics::LawlessBase64), "Lawless", "Lawless - Anything Goes", "Lawless", "Lawless", false, false, 101);
         }
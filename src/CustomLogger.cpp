@@ -0,0 +1,125 @@
+#include "CustomLogger.hpp"
+
+#include <atomic>
+#include <cstdarg>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Must be a power of two
+#define LOG_QUEUE_SIZE 2048
+#define LOG_MESSAGE_SIZE 512
+
+namespace RuntimeSongLoader::AsyncLogger {
+
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        Level level;
+        // Length vsnprintf wanted, above LOG_MESSAGE_SIZE - 1 if the message was cut
+        int size;
+        char message[LOG_MESSAGE_SIZE];
+    };
+
+    // Bounded MPSC queue (Vyukov), producers never block and drop messages when it is full
+    struct Queue {
+        Slot slots[LOG_QUEUE_SIZE];
+        std::atomic<std::size_t> enqueuePosition = 0;
+        std::size_t dequeuePosition = 0;
+        std::atomic<uint32_t> droppedMessages = 0;
+        // Futex word, 1 while the consumer waits for messages
+        std::atomic<uint32_t> sleeping = 0;
+
+        Queue() {
+            for(std::size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    };
+
+    void WriteMessage(Level level, const char* message) {
+        switch(level) {
+            case Level::Error:
+                getLogger().error("%s", message);
+                break;
+            case Level::Warn:
+                getLogger().warning("%s", message);
+                break;
+            case Level::Info:
+                getLogger().info("%s", message);
+                break;
+            case Level::Debug:
+                getLogger().debug("%s", message);
+                break;
+        }
+    }
+
+    void FutexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void FutexWake(std::atomic<uint32_t>& word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    void ConsumeMessages(Queue* queue) {
+        while(true) {
+            auto& slot = queue->slots[queue->dequeuePosition & (LOG_QUEUE_SIZE - 1)];
+            if(slot.sequence.load(std::memory_order_acquire) != queue->dequeuePosition + 1) {
+                auto dropped = queue->droppedMessages.exchange(0, std::memory_order_relaxed);
+                if(dropped > 0)
+                    getLogger().warning("Dropped %u log messages, the queue was full!", dropped);
+                // Announce the wait before checking again, a producer either sees the flag or its message is seen here
+                queue->sleeping.store(1, std::memory_order_seq_cst);
+                if(slot.sequence.load(std::memory_order_seq_cst) != queue->dequeuePosition + 1)
+                    FutexWait(queue->sleeping, 1);
+                queue->sleeping.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            WriteMessage(slot.level, slot.message);
+            if(slot.size >= LOG_MESSAGE_SIZE)
+                getLogger().warning("The previous log message was truncated from %d to %d bytes", slot.size, LOG_MESSAGE_SIZE - 1);
+            slot.sequence.store(queue->dequeuePosition + LOG_QUEUE_SIZE, std::memory_order_release);
+            queue->dequeuePosition++;
+        }
+    }
+
+    Queue& GetQueue() {
+        static Queue* queue = [] {
+            auto newQueue = new Queue();
+            std::thread(ConsumeMessages, newQueue).detach();
+            return newQueue;
+        }();
+        return *queue;
+    }
+
+    void Log(Level level, const char* format, ...) {
+        auto& queue = GetQueue();
+        auto position = queue.enqueuePosition.load(std::memory_order_relaxed);
+        Slot* slot;
+        while(true) {
+            slot = &queue.slots[position & (LOG_QUEUE_SIZE - 1)];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = (intptr_t) sequence - (intptr_t) position;
+            if(difference == 0) {
+                if(queue.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            } else if(difference < 0) {
+                queue.droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = queue.enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        // Formatted here and not on the consumer, the arguments are mostly c_str() of temporaries that are gone once Log returns
+        va_list arguments;
+        va_start(arguments, format);
+        slot->size = vsnprintf(slot->message, LOG_MESSAGE_SIZE, format, arguments);
+        va_end(arguments);
+        slot->level = level;
+        slot->sequence.store(position + 1, std::memory_order_seq_cst);
+        // Only costs a syscall when the consumer is idle
+        if(queue.sleeping.load(std::memory_order_seq_cst) && queue.sleeping.exchange(0, std::memory_order_relaxed))
+            FutexWake(queue.sleeping);
+    }
+
+}
@@ -6,6 +6,8 @@
 #include "Sprites.hpp"
 
 #include "LoadingUI.hpp"
+#include "LoadScheduler.hpp"
+#include "Prescan.hpp"
 
 #include "API.hpp"
 
@@ -14,6 +16,13 @@
 #include "Utils/CacheUtils.hpp"
 #include "Utils/OggVorbisUtils.hpp"
 #include "Utils/FindComponentsUtils.hpp"
+#include "Utils/SearchUtils.hpp"
+#include "Utils/ResolveUtils.hpp"
+#include "Utils/InternUtils.hpp"
+#include "Utils/ThreadUtils.hpp"
+#include "Utils/SnapshotUtils.hpp"
+#include "Utils/LevelInfoUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 
 #include "questui/shared/BeatSaberUI.hpp"
 #include "questui/shared/CustomTypes/Components/MainThreadScheduler.hpp"
@@ -39,6 +48,9 @@
 #include "GlobalNamespace/BeatmapCharacteristicSO.hpp"
 #include "GlobalNamespace/BeatmapLevelPackCollection.hpp"
 #include "GlobalNamespace/BeatmapLevelPackCollectionSO.hpp"
+#include "GlobalNamespace/BeatmapLevelPack.hpp"
+#include "GlobalNamespace/IBeatmapLevelCollection.hpp"
+#include "GlobalNamespace/IPreviewBeatmapLevel.hpp"
 #include "GlobalNamespace/EnvironmentInfoSO.hpp"
 #include "GlobalNamespace/EnvironmentsListSO.hpp"
 #include "GlobalNamespace/CachedMediaAsyncLoader.hpp"
@@ -60,12 +72,25 @@
 #include "System/IO/Path.hpp"
 #include "System/IO/Directory.hpp"
 #include "System/Threading/Thread.hpp"
+#include "System/Collections/Generic/Dictionary_2.hpp"
 
 #include <vector>
+#include <array>
 #include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #define MAX_THREADS 8
 
+// Refresh requests closer together than this get merged into one refresh
+#define REFRESH_DEBOUNCE_MS 300
+
+// Levels added to the game's preview levels per commit step
+#define PREVIEW_LEVELS_PER_STEP 1000
+
 using namespace RuntimeSongLoader;
 using namespace GlobalNamespace;
 using namespace BeatmapSaveDataVersion3;
@@ -75,12 +100,6 @@ using namespace System::Threading;
 using namespace System::Collections::Generic;
 using namespace FindComponentsUtils;
 
-#define FixEmptyString(name) \
-if(!name) { \
-    LOG_WARN("Fixed nullptr string \"%s\"! THIS SHOULDN'T HAPPEN!", #name);\
-    name = System::String::_get_Empty(); \
-}
-
 DEFINE_TYPE(RuntimeSongLoader, SongLoader);
 
 SongLoader* SongLoader::Instance = nullptr;
@@ -95,14 +114,27 @@ SongLoader* SongLoader::GetInstance() {
     return Instance;
 }
 
-std::vector<std::function<void(std::vector<CustomPreviewBeatmapLevel*> const&)>> SongLoader::LoadedEvents;
-std::mutex SongLoader::LoadedEventsMutex;
+EventList<std::vector<CustomPreviewBeatmapLevel*> const&> SongLoader::LoadedEvents("SongsLoaded");
+
+EventList<SongLoaderBeatmapLevelPackCollectionSO*> SongLoader::RefreshLevelPacksEvents("RefreshLevelPacks");
+
+EventList<CustomPreviewBeatmapLevel*> SongLoader::SongDeletedEvents("SongDeleted");
 
-std::vector<std::function<void(SongLoaderBeatmapLevelPackCollectionSO*)>> SongLoader::RefreshLevelPacksEvents;
-std::mutex SongLoader::RefreshLevelPacksEventsMutex;
+EventList<LevelsChangeSet const&> SongLoader::LevelsChangedEvents("LevelsChanged");
 
-std::vector<std::function<void()>> SongLoader::SongDeletedEvents;
-std::mutex SongLoader::SongDeletedEventsMutex;
+std::string GetTrashPath() {
+    return GetBaseLevelsPath() + TrashFolder + "/";
+}
+
+void SongLoader::EmptyTrash() {
+    LoadScheduler::Scope scope(LoadPriority::Background);
+    auto trashPath = GetTrashPath();
+    for(auto& path : FileUtils::GetFolders(trashPath)) {
+        LoadScheduler::Yield(LoadPriority::Background);
+        FileUtils::DeleteFolder(path);
+    }
+    FileUtils::DeleteFolder(trashPath);
+}
 
 std::vector<CustomPreviewBeatmapLevel*> SongLoader::GetLoadedLevels() {
     return LoadedLevels;
@@ -118,9 +150,6 @@ void SongLoader::ctor() {
 
     beatmapDataLoader = BeatmapDataLoader::New_ctor();
 
-    CustomLevels = Dictionary_2<StringW, CustomPreviewBeatmapLevel*>::New_ctor();
-    CustomWIPLevels = Dictionary_2<StringW, CustomPreviewBeatmapLevel*>::New_ctor();
-
     CustomLevelsPack = SongLoaderCustomBeatmapLevelPack::Make_New(CustomLevelsFolder, "Custom Levels");
     CustomWIPLevelsPack = SongLoaderCustomBeatmapLevelPack::Make_New(CustomWIPLevelsFolder, "WIP Levels", QuestUI::BeatSaberUI::Base64ToSprite(Sprites::CustomWIPLevelsCover));
     CustomBeatmapLevelPackCollectionSO = RuntimeSongLoader::SongLoaderBeatmapLevelPackCollectionSO::CreateNew();
@@ -131,77 +160,162 @@ void SongLoader::Awake() {
         LoadingCancelled = true;
 }
 
+BackgroundScanOptions SongLoader::BackgroundOptions;
+std::mutex SongLoader::BackgroundOptionsMutex;
+
+void SongLoader::SetBackgroundScanOptions(BackgroundScanOptions const& options) {
+    std::lock_guard<std::mutex> lock(BackgroundOptionsMutex);
+    BackgroundOptions = options;
+}
+
+BackgroundScanOptions SongLoader::GetBackgroundScanOptions() {
+    std::lock_guard<std::mutex> lock(BackgroundOptionsMutex);
+    return BackgroundOptions;
+}
+
+void SongLoader::MenuLoaded() {
+    QueuedRefresh.waitForMenu = false;
+    if(!PendingCommit)
+        return;
+    LOG_INFO("Committing the levels of the background scan");
+    auto commit = std::move(PendingCommit);
+    PendingCommit = nullptr;
+    commit();
+}
+
 void SongLoader::Update() {
-    if(IsLoading)
+    if(IsLoading && !IsBackgroundScan)
         LoadingUI::UpdateLoadingProgress(MaxFolders, CurrentFolder);
     LoadingUI::UpdateState();
+    CommitQueue.Run();
+    StartQueuedRefresh();
 }
 
-CustomJSONData::CustomLevelInfoSaveData* SongLoader::GetStandardLevelInfoSaveData(std::string const& customLevelPath) {
-    std::string path = customLevelPath + "/info.dat";
-    if(!fileexists(path))
-        path = customLevelPath + "/Info.dat";
-    if(fileexists(path)) {
-        try {
-            auto standardLevelInfoSaveData = StandardLevelInfoSaveData::DeserializeFromJSONString(FileUtils::ReadAllText16(path));
-            if (!standardLevelInfoSaveData) {
-                LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s!", (path).c_str());
-                return nullptr;
-            }
-            auto optional = il2cpp_utils::try_cast<CustomJSONData::CustomLevelInfoSaveData>(standardLevelInfoSaveData);
-            if (!optional.has_value()) {
-                LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s as CustomLevelInfoSaveData!", (path).c_str());
-                return nullptr;
-            }
-            return optional.value();
-        } catch(const std::runtime_error& e) {
-            LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s: %s!", (path).c_str(), e.what());
+CustomJSONData::CustomLevelInfoSaveData* SongLoader::LoadStandardLevelInfoSaveData(CustomPreviewBeatmapLevel* level) {
+    if(!level || !level->standardLevelInfoSaveData)
+        return nullptr;
+    return il2cpp_utils::try_cast<CustomJSONData::CustomLevelInfoSaveData>(level->standardLevelInfoSaveData).value_or(nullptr);
+}
+
+CustomJSONData::CustomLevelInfoSaveData* SongLoader::ParseStandardLevelInfoSaveData(std::string_view infoText, std::string const& path) {
+    // Same BOM handling as LevelInfoUtils::Parse
+    if(infoText.starts_with("\xEF\xBB\xBF"))
+        infoText.remove_prefix(3);
+    try {
+        auto standardLevelInfoSaveData = StandardLevelInfoSaveData::DeserializeFromJSONString(StringW(to_utf16(infoText)));
+        if (!standardLevelInfoSaveData) {
+            LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s!", (path).c_str());
+            return nullptr;
         }
-    } else {
-        LOG_ERROR("GetStandardLevelInfoSaveData File %s doesn't exist!", (path).c_str());
+        auto optional = il2cpp_utils::try_cast<CustomJSONData::CustomLevelInfoSaveData>(standardLevelInfoSaveData);
+        if (!optional.has_value()) {
+            LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s as CustomLevelInfoSaveData!", (path).c_str());
+            return nullptr;
+        }
+        InternUtils::InternStrings(optional.value());
+        return optional.value();
+    } catch(const std::runtime_error& e) {
+        LOG_ERROR("GetStandardLevelInfoSaveData Can't Load File %s: %s!", (path).c_str(), e.what());
     }
     return nullptr;
 }
 
-EnvironmentInfoSO* SongLoader::LoadEnvironmentInfo(StringW environmentName, bool allDirections) {
-    auto customlevelLoader = GetCustomLevelLoader();
-    EnvironmentInfoSO* environmentInfoSO = customlevelLoader->environmentSceneInfoCollection->GetEnvironmentInfoBySerializedName(environmentName);
+EnvironmentInfoSO* SongLoader::LoadEnvironmentInfo(CustomLevelLoader* customlevelLoader, std::string_view environmentName, bool allDirections) {
+    EnvironmentInfoSO* environmentInfoSO = ResolveUtils::GetEnvironmentInfo(environmentName);
     if(!environmentInfoSO)
         environmentInfoSO = (allDirections ? customlevelLoader->defaultAllDirectionsEnvironmentInfo : customlevelLoader->defaultEnvironmentInfo);
     LOG_DEBUG("LoadEnvironmentInfo: %p", environmentInfoSO);
     return environmentInfoSO;
 }
 
-CustomPreviewBeatmapLevel* SongLoader::LoadCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, std::string& outHash) {
-    if(!standardLevelInfoSaveData) 
+std::string GetSaveDataString(StringW text) {
+    return text ? static_cast<std::string>(text) : "";
+}
+
+// Copies the fields the level is created from, so the info.dat isn't parsed a second time natively
+LevelInfoUtils::LevelInfo GetLevelInfo(CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData) {
+    LevelInfoUtils::LevelInfo info;
+    info.songName = GetSaveDataString(standardLevelInfoSaveData->songName);
+    info.songSubName = GetSaveDataString(standardLevelInfoSaveData->songSubName);
+    info.songAuthorName = GetSaveDataString(standardLevelInfoSaveData->songAuthorName);
+    info.levelAuthorName = GetSaveDataString(standardLevelInfoSaveData->levelAuthorName);
+    info.beatsPerMinute = standardLevelInfoSaveData->beatsPerMinute;
+    info.songTimeOffset = standardLevelInfoSaveData->songTimeOffset;
+    info.shuffle = standardLevelInfoSaveData->shuffle;
+    info.shufflePeriod = standardLevelInfoSaveData->shufflePeriod;
+    info.previewStartTime = standardLevelInfoSaveData->previewStartTime;
+    info.previewDuration = standardLevelInfoSaveData->previewDuration;
+    info.songFilename = GetSaveDataString(standardLevelInfoSaveData->songFilename);
+    info.environmentName = GetSaveDataString(standardLevelInfoSaveData->environmentName);
+    info.allDirectionsEnvironmentName = GetSaveDataString(standardLevelInfoSaveData->allDirectionsEnvironmentName);
+    if(!standardLevelInfoSaveData->difficultyBeatmapSets)
+        return info;
+    for(auto difficultyBeatmapSet : standardLevelInfoSaveData->difficultyBeatmapSets) {
+        if(!difficultyBeatmapSet)
+            continue;
+        auto& setInfo = info.difficultyBeatmapSets.emplace_back();
+        setInfo.beatmapCharacteristicName = GetSaveDataString(difficultyBeatmapSet->beatmapCharacteristicName);
+        if(!difficultyBeatmapSet->difficultyBeatmaps)
+            continue;
+        for(auto difficultyBeatmap : difficultyBeatmapSet->difficultyBeatmaps) {
+            if(!difficultyBeatmap)
+                continue;
+            setInfo.difficulties.push_back(GetSaveDataString(difficultyBeatmap->difficulty));
+            setInfo.beatmapFilenames.push_back(GetSaveDataString(difficultyBeatmap->beatmapFilename));
+        }
+    }
+    return info;
+}
+
+CustomPreviewBeatmapLevel* SongLoader::LoadCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, std::string& outHash) {
+    auto infoText = LevelInfoUtils::ReadInfoText(customLevelPath);
+    auto standardLevelInfoSaveData = infoText.empty() ? nullptr : ParseStandardLevelInfoSaveData(infoText, customLevelPath);
+    if(!standardLevelInfoSaveData) {
+        LOG_ERROR("LoadCustomPreviewBeatmapLevel Can't Load info.dat of %s!", customLevelPath.c_str());
         return nullptr;
-    LOG_DEBUG("LoadCustomPreviewBeatmapLevel StandardLevelInfoSaveData: ");
-    auto hashOpt = HashUtils::GetCustomLevelHash(standardLevelInfoSaveData, customLevelPath);
+    }
+    auto info = GetLevelInfo(standardLevelInfoSaveData);
+    auto hashOpt = HashUtils::GetCustomLevelHash(customLevelPath, info.GetDifficultyFiles());
     if(!hashOpt.has_value())
         return nullptr;
     outHash = *hashOpt;
-    std::string stringLevelID = CustomLevelPrefixID + outHash;
+    auto result = CreateCustomPreviewBeatmapLevel(customLevelPath, wip, info, standardLevelInfoSaveData, outHash);
+    UpdateSongDuration(result, customLevelPath, info);
+    return result;
+}
+
+BeatmapDifficulty GetBeatmapDifficulty(std::string_view serializedName) {
+    if(serializedName == "Easy")
+        return BeatmapDifficulty::Easy;
+    if(serializedName == "Hard")
+        return BeatmapDifficulty::Hard;
+    if(serializedName == "Expert")
+        return BeatmapDifficulty::Expert;
+    if(serializedName == "ExpertPlus")
+        return BeatmapDifficulty::ExpertPlus;
+    // Same fallback as BeatmapDifficultySerializedMethods
+    return BeatmapDifficulty::Normal;
+}
+
+CustomPreviewBeatmapLevel* SongLoader::CreateCustomPreviewBeatmapLevel(std::string const& customLevelPath, bool wip, LevelInfoUtils::LevelInfo const& info, CustomJSONData::CustomLevelInfoSaveData* standardLevelInfoSaveData, std::string const& hash) {
+    std::string stringLevelID = CustomLevelPrefixID + hash;
     if(wip)
         stringLevelID += " WIP";
-    StringW songName = standardLevelInfoSaveData->songName;
-    FixEmptyString(songName)
-    StringW songSubName = standardLevelInfoSaveData->songSubName;
-    FixEmptyString(songSubName)
-    StringW songAuthorName = standardLevelInfoSaveData->songAuthorName;
-    FixEmptyString(songAuthorName)
-    StringW levelAuthorName = standardLevelInfoSaveData->levelAuthorName;
-    FixEmptyString(levelAuthorName)
-    float beatsPerMinute = standardLevelInfoSaveData->beatsPerMinute;
-    float songTimeOffset = standardLevelInfoSaveData->songTimeOffset;
-    float shuffle = standardLevelInfoSaveData->shuffle;
-    float shufflePeriod = standardLevelInfoSaveData->shufflePeriod;
-    float previewStartTime = standardLevelInfoSaveData->previewStartTime;
-    float previewDuration = standardLevelInfoSaveData->previewDuration;
+    StringW songName(info.songName);
+    StringW songSubName(info.songSubName);
+    StringW songAuthorName = InternUtils::InternString(std::string_view(info.songAuthorName));
+    StringW levelAuthorName = InternUtils::InternString(std::string_view(info.levelAuthorName));
+    float beatsPerMinute = info.beatsPerMinute;
+    float songTimeOffset = info.songTimeOffset;
+    float shuffle = info.shuffle;
+    float shufflePeriod = info.shufflePeriod;
+    float previewStartTime = info.previewStartTime;
+    float previewDuration = info.previewDuration;
     LOG_DEBUG("levelID: %s", stringLevelID.c_str());
-    LOG_DEBUG("songName: %s", static_cast<std::string>(songName).c_str());
-    LOG_DEBUG("songSubName: %s", static_cast<std::string>(songSubName).c_str());
-    LOG_DEBUG("songAuthorName: %s", static_cast<std::string>(songAuthorName).c_str());
-    LOG_DEBUG("levelAuthorName: %s", static_cast<std::string>(levelAuthorName).c_str());
+    LOG_DEBUG("songName: %s", info.songName.c_str());
+    LOG_DEBUG("songSubName: %s", info.songSubName.c_str());
+    LOG_DEBUG("songAuthorName: %s", info.songAuthorName.c_str());
+    LOG_DEBUG("levelAuthorName: %s", info.levelAuthorName.c_str());
     LOG_DEBUG("beatsPerMinute: %f", beatsPerMinute);
     LOG_DEBUG("songTimeOffset: %f", songTimeOffset);
     LOG_DEBUG("shuffle: %f", shuffle);
@@ -209,32 +323,27 @@ CustomPreviewBeatmapLevel* SongLoader::LoadCustomPreviewBeatmapLevel(std::string
     LOG_DEBUG("previewStartTime: %f", previewStartTime);
     LOG_DEBUG("previewDuration: %f", previewDuration);
 
-    EnvironmentInfoSO* environmentInfo = LoadEnvironmentInfo(standardLevelInfoSaveData->environmentName, false);
-    EnvironmentInfoSO* allDirectionsEnvironmentInfo = LoadEnvironmentInfo(standardLevelInfoSaveData->allDirectionsEnvironmentName, true);
-    List<PreviewDifficultyBeatmapSet*>* list = List<PreviewDifficultyBeatmapSet*>::New_ctor();
-    for(StandardLevelInfoSaveData::DifficultyBeatmapSet* difficultyBeatmapSet : standardLevelInfoSaveData->difficultyBeatmapSets) {
-        if (!difficultyBeatmapSet)
-            continue;
-
-        BeatmapCharacteristicSO* beatmapCharacteristicBySerializedName = GetCustomLevelLoader()->beatmapCharacteristicCollection->GetBeatmapCharacteristicBySerializedName(difficultyBeatmapSet->beatmapCharacteristicName);
-        LOG_DEBUG("beatmapCharacteristicBySerializedName: %s", static_cast<std::string>(difficultyBeatmapSet->beatmapCharacteristicName).c_str());
+    auto customLevelLoader = GetCustomLevelLoader();
+    EnvironmentInfoSO* environmentInfo = LoadEnvironmentInfo(customLevelLoader, info.environmentName, false);
+    EnvironmentInfoSO* allDirectionsEnvironmentInfo = LoadEnvironmentInfo(customLevelLoader, info.allDirectionsEnvironmentName, true);
+    std::vector<InternUtils::PreviewDifficultyBeatmapSetInfo> previewSets;
+    for(auto& difficultyBeatmapSet : info.difficultyBeatmapSets) {
+        BeatmapCharacteristicSO* beatmapCharacteristicBySerializedName = ResolveUtils::GetBeatmapCharacteristic(std::string_view(difficultyBeatmapSet.beatmapCharacteristicName));
+        LOG_DEBUG("beatmapCharacteristicBySerializedName: %s", difficultyBeatmapSet.beatmapCharacteristicName.c_str());
         if(beatmapCharacteristicBySerializedName) {
-            ArrayW<BeatmapDifficulty> array = ArrayW<BeatmapDifficulty>(difficultyBeatmapSet->difficultyBeatmaps.Length());
-            for(int j = 0; j < array.Length(); j++) {
-                BeatmapDifficulty beatmapDifficulty;
-                BeatmapDifficultySerializedMethods::BeatmapDifficultyFromSerializedName(difficultyBeatmapSet->difficultyBeatmaps[j]->difficulty, beatmapDifficulty);
-                array[j] = beatmapDifficulty;
-            }
-            list->Add(PreviewDifficultyBeatmapSet::New_ctor(beatmapCharacteristicBySerializedName, array));
+            auto& previewSet = previewSets.emplace_back();
+            previewSet.beatmapCharacteristic = beatmapCharacteristicBySerializedName;
+            for(auto& difficulty : difficultyBeatmapSet.difficulties)
+                previewSet.beatmapDifficulties.push_back(GetBeatmapDifficulty(difficulty));
         }
     }
+    // Most levels share a few combinations, so the sets are shared instead of allocated per level
+    auto previewDifficultyBeatmapSets = InternUtils::GetPreviewDifficultyBeatmapSets(previewSets);
     LOG_DEBUG("LoadCustomPreviewBeatmapLevel Stop");
-    auto result = CustomPreviewBeatmapLevel::New_ctor(GetCustomLevelLoader()->defaultPackCover, standardLevelInfoSaveData, customLevelPath, reinterpret_cast<ISpriteAsyncLoader*>(GetCachedMediaAsyncLoader()), stringLevelID, songName, songSubName, songAuthorName, levelAuthorName, beatsPerMinute, songTimeOffset, shuffle, shufflePeriod, previewStartTime, previewDuration, environmentInfo, allDirectionsEnvironmentInfo, reinterpret_cast<IReadOnlyList_1<PreviewDifficultyBeatmapSet*>*>(list));
-    UpdateSongDuration(result, customLevelPath);
-    return result;
+    return CustomPreviewBeatmapLevel::New_ctor(customLevelLoader->defaultPackCover, static_cast<StandardLevelInfoSaveData*>(standardLevelInfoSaveData), customLevelPath, reinterpret_cast<ISpriteAsyncLoader*>(GetCachedMediaAsyncLoader()), stringLevelID, songName, songSubName, songAuthorName, levelAuthorName, beatsPerMinute, songTimeOffset, shuffle, shufflePeriod, previewStartTime, previewDuration, environmentInfo, allDirectionsEnvironmentInfo, previewDifficultyBeatmapSets);
 }
 
-void SongLoader::UpdateSongDuration(CustomPreviewBeatmapLevel* level, std::string const& customLevelPath) {
+void SongLoader::UpdateSongDuration(CustomPreviewBeatmapLevel* level, std::string const& customLevelPath, LevelInfoUtils::LevelInfo const& info) {
     float length = 0.0f;
     auto cacheDataOpt = CacheUtils::GetCacheData(customLevelPath);
     if(!cacheDataOpt.has_value())
@@ -245,9 +354,9 @@ void SongLoader::UpdateSongDuration(CustomPreviewBeatmapLevel* level, std::strin
         length = *cacheSongDuration;
     } else {
         if(length <= 0.0f || length == INFINITY)
-            length = OggVorbisUtils::GetLengthFromOggVorbisFile(customLevelPath + "/" + static_cast<std::string>(level->standardLevelInfoSaveData->songFilename));
+            length = OggVorbisUtils::GetLengthFromLevelAudio(customLevelPath, info.songFilename);
         if(length <= 0.0f || length == INFINITY)
-            length = GetLengthFromMap(level, customLevelPath);
+            length = GetLengthFromMap(level, customLevelPath, info);
     }
     if(length < 0.0f || length == INFINITY)
         length = 0.0f;
@@ -256,22 +365,21 @@ void SongLoader::UpdateSongDuration(CustomPreviewBeatmapLevel* level, std::strin
     CacheUtils::UpdateCacheData(customLevelPath, cacheData);
 }
 
-float SongLoader::GetLengthFromMap(CustomPreviewBeatmapLevel* level, std::string const& customLevelPath) {
+float SongLoader::GetLengthFromMap(CustomPreviewBeatmapLevel* level, std::string const& customLevelPath, LevelInfoUtils::LevelInfo const& info) {
     std::string diffFile = "";
-    try
-    {
-        diffFile = static_cast<std::string>(level->standardLevelInfoSaveData->difficultyBeatmapSets.First()->difficultyBeatmaps.Last()->beatmapFilename);
-    } catch (std::runtime_error e)
-    {
-        LOG_ERROR("GetLengthFromMap Error finding diffFile: %s", e.what());
-    }
+    if(!info.difficultyBeatmapSets.empty() && !info.difficultyBeatmapSets.front().beatmapFilenames.empty())
+        diffFile = info.difficultyBeatmapSets.front().beatmapFilenames.back();
+    else
+        LOG_ERROR("GetLengthFromMap Error finding diffFile");
     std::string path = customLevelPath + "/" + diffFile;
-    if(!fileexists(path)) {
+    // Members of zipped songs are inflated in memory
+    auto text = ZipUtils::ReadLevelFile(customLevelPath, diffFile);
+    if(!text.has_value()) {
         LOG_ERROR("GetLengthFromMap File %s doesn't exist!", (path).c_str());
         return 0.0f;
     }
     try {
-        auto beatmapSaveData = BeatmapSaveData::DeserializeFromJSONString(FileUtils::ReadAllText16(path));
+        auto beatmapSaveData = BeatmapSaveData::DeserializeFromJSONString(StringW(*text));
         if(!beatmapSaveData) {
             LOG_ERROR("GetLengthFromMap File %s is corrupted!", (path).c_str());
             return 0.0f;
@@ -289,184 +397,710 @@ float SongLoader::GetLengthFromMap(CustomPreviewBeatmapLevel* level, std::string
     return 0.0f;
 }
 
-ArrayW<CustomPreviewBeatmapLevel*> GetDictionaryValues(Dictionary_2<StringW, CustomPreviewBeatmapLevel*>* dictionary) {
-    if(!dictionary)
-        return ArrayW<CustomPreviewBeatmapLevel*>();
-    auto array = ArrayW<CustomPreviewBeatmapLevel*>(dictionary->get_Count());
-    dictionary->get_Values()->CopyTo(array, 0);
-    return array;
+// Runs work for every index on up to MAX_THREADS tasks and blocks until all of them are done
+// Between indices the tasks yield to loading work of a higher priority
+void RunParallel(int count, std::function<void(int)> const& work, LoadPriority priority = LoadPriority::Refresh) {
+    std::atomic_int threadsFinished = 0;
+    std::atomic_int index = 0;
+    auto runWork = [count, &work, &index, &threadsFinished, priority] {
+        LoadScheduler::Scope scope(priority);
+        int i = index++;
+        while(i < count) {
+            LoadScheduler::Yield(priority);
+            work(i);
+            i = index++;
+        }
+        threadsFinished++;
+    };
+    int threadsCount = std::min(count, MAX_THREADS);
+    if(priority == LoadPriority::Background) {
+        // Lowered priorities can't be raised again, so background work gets own threads instead of pooled tasks
+        auto options = SongLoader::GetBackgroundScanOptions();
+        threadsCount = std::clamp(options.threads, 1, std::max(threadsCount, 1));
+        for(int threadIndex = 0; threadIndex < threadsCount; threadIndex++) {
+            std::thread([runWork, options] {
+                auto thread = il2cpp_functions::thread_attach(il2cpp_functions::domain_get());
+                ThreadUtils::LowerCurrentThreadPriority(options.niceness, options.efficiencyCoresOnly);
+                runWork();
+                il2cpp_functions::thread_detach(thread);
+            }).detach();
+        }
+    } else {
+        for(int threadIndex = 0; threadIndex < threadsCount; threadIndex++) {
+            HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
+                (std::function<void()>)runWork
+            ), nullptr)->Run();
+        }
+    }
+    //Wait for threads to finish
+    while(threadsFinished < threadsCount) {
+        Thread::Yield();
+    }
 }
 
-void SongLoader::RefreshLevelPacks(bool includeDefault) const {
-    CustomBeatmapLevelPackCollectionSO->ClearLevelPacks();
+bool IsMenuActive() {
+    SceneManagement::Scene activeScene = SceneManagement::SceneManager::GetActiveScene();
+    return activeScene.IsValid() && static_cast<std::string>(activeScene.get_name()).find("Menu") != std::string::npos;
+}
 
-    if(includeDefault) {
-        CustomLevelsPack->SortLevels();
-        CustomLevelsPack->AddTo(CustomBeatmapLevelPackCollectionSO);
-        CustomWIPLevelsPack->SortLevels();
-        CustomWIPLevelsPack->AddTo(CustomBeatmapLevelPackCollectionSO);
+// Song data files a load read, audio and images are only read on demand
+// Taken from the listing the cache check of the load did, the folder isn't listed again
+uint64_t GetLoadedDataFilesSize(std::string const& songPath) {
+    uint64_t size = 0;
+    // Zipped songs are read through their central directory, which the load opened already
+    if(ZipUtils::IsArchivePath(songPath)) {
+        if(auto archive = ZipUtils::GetArchive(songPath)) {
+            for(auto& entry : archive->GetEntries()) {
+                if(entry.name.ends_with(".dat"))
+                    size += entry.compressedSize;
+            }
+        }
+        return size;
     }
+    auto cacheData = CacheUtils::PeekCacheData(songPath);
+    return cacheData.has_value() ? cacheData->dataFilesSize : 0;
+}
+
+// Directory hash the last load of the level was checked against
+std::optional<int> GetCachedDirectoryHash(std::string const& path) {
+    auto cacheData = CacheUtils::PeekCacheData(path);
+    if(!cacheData.has_value())
+        return std::nullopt;
+    return cacheData->directoryHash;
+}
 
-    std::lock_guard<std::mutex> lock(RefreshLevelPacksEventsMutex);
-    for (auto& event : RefreshLevelPacksEvents) {
-        event(CustomBeatmapLevelPackCollectionSO);
+// Song folders or zipped songs
+bool LevelExists(std::string const& path) {
+    if(ZipUtils::IsArchivePath(path))
+        return ZipUtils::GetArchiveHash(path).has_value();
+    return direxists(path);
+}
+
+LevelChange MakeLevelChange(CustomPreviewBeatmapLevel* level, CustomPreviewBeatmapLevel* previousLevel = nullptr) {
+    return { static_cast<std::string>(level->customLevelPath), static_cast<std::string>(level->levelID), level, previousLevel };
+}
+
+// Only levels that differ get their strings converted, unchanged levels keep their objects and are matched by pointer
+LevelsChangeSet GetLevelsChangeSet(std::vector<CustomPreviewBeatmapLevel*> const& previousLevels, std::vector<CustomPreviewBeatmapLevel*> const& levels) {
+    LevelsChangeSet changeSet;
+    std::unordered_set<CustomPreviewBeatmapLevel*> previousSet(previousLevels.begin(), previousLevels.end());
+    std::unordered_set<CustomPreviewBeatmapLevel*> currentSet(levels.begin(), levels.end());
+    std::unordered_map<std::string, CustomPreviewBeatmapLevel*> removedByPath;
+    for(auto level : previousLevels) {
+        if(!currentSet.contains(level))
+            removedByPath.emplace(static_cast<std::string>(level->customLevelPath), level);
     }
+    for(auto level : levels) {
+        if(previousSet.contains(level))
+            continue;
+        auto change = MakeLevelChange(level);
+        auto search = removedByPath.find(change.path);
+        if(search != removedByPath.end()) {
+            change.previousLevel = search->second;
+            removedByPath.erase(search);
+            changeSet.changed.push_back(std::move(change));
+        } else {
+            changeSet.added.push_back(std::move(change));
+        }
+    }
+    for(auto& [path, level] : removedByPath)
+        changeSet.removed.push_back(MakeLevelChange(level));
+    return changeSet;
+}
+
+ArrayW<CustomPreviewBeatmapLevel*> ToArrayW(std::vector<CustomPreviewBeatmapLevel*> const& levels) {
+    auto array = ArrayW<CustomPreviewBeatmapLevel*>(levels.size());
+    std::copy(levels.begin(), levels.end(), array.begin());
+    return array;
+}
+
+CustomPreviewBeatmapLevel* SongLoader::GetLevelById(std::string_view levelID) {
+    return Registry.FindById(levelID);
+}
+
+void SongLoader::RefreshLevelPacks(bool includeDefault, bool force) {
+    for(auto& step : GetRefreshLevelPacksSteps(includeDefault, force)) {
+        while(!step());
+    }
+}
+
+// Same as BeatmapLevelsModel::UpdateLoadedPreviewLevels, but adds the levels over several calls
+// The game keeps its current dictionary until the new one is complete
+FrameWorkQueue::Step MakeUpdateLoadedPreviewLevelsStep(BeatmapLevelsModel* beatmapLevelsModel) {
+    struct State {
+        BeatmapLevelPackCollection* collection = nullptr;
+        Dictionary_2<StringW, IPreviewBeatmapLevel*>* levels = nullptr;
+        int packIndex = 0;
+        int levelIndex = 0;
+        // The collection and dictionary aren't referenced by the game until the swap
+        std::array<uint32_t, 2> handles = {};
+
+        ~State() {
+            Release();
+        }
+
+        void Release() {
+            for(auto& handle : handles) {
+                if(handle)
+                    il2cpp_functions::gchandle_free(handle);
+                handle = 0;
+            }
+        }
+    };
+    auto state = std::make_shared<State>();
+    return [beatmapLevelsModel, state] {
+        auto currentCollection = reinterpret_cast<BeatmapLevelPackCollection*>(beatmapLevelsModel->allLoadedBeatmapLevelPackCollection);
+        // Starts over if the packs got replaced in between, the game updated its own dictionary then
+        if(!state->levels || state->collection != currentCollection) {
+            beatmapLevelsModel->UpdateAllLoadedBeatmapLevelPacks();
+            state->Release();
+            state->collection = reinterpret_cast<BeatmapLevelPackCollection*>(beatmapLevelsModel->allLoadedBeatmapLevelPackCollection);
+            state->levels = Dictionary_2<StringW, IPreviewBeatmapLevel*>::New_ctor();
+            state->packIndex = 0;
+            state->levelIndex = 0;
+            state->handles[0] = il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(state->collection), false);
+            state->handles[1] = il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(state->levels), false);
+        }
+        auto packs = state->collection ? state->collection->get_beatmapLevelPacks() : ArrayW<IBeatmapLevelPack*>();
+        int added = 0;
+        while(state->packIndex < packs.Length() && added < PREVIEW_LEVELS_PER_STEP) {
+            auto levels = ArrayW<IPreviewBeatmapLevel*>(reinterpret_cast<Array<IPreviewBeatmapLevel*>*>(reinterpret_cast<BeatmapLevelPack*>(packs[state->packIndex])->get_beatmapLevelCollection()->get_beatmapLevels()));
+            for(; state->levelIndex < levels.Length() && added < PREVIEW_LEVELS_PER_STEP; state->levelIndex++, added++) {
+                auto level = levels[state->levelIndex];
+                state->levels->set_Item(level->get_levelID(), level);
+            }
+            if(state->levelIndex >= levels.Length()) {
+                state->packIndex++;
+                state->levelIndex = 0;
+            }
+        }
+        if(state->packIndex < packs.Length())
+            return false;
+        beatmapLevelsModel->loadedPreviewBeatmapLevels = state->levels;
+        state->Release();
+        state->levels = nullptr;
+        return true;
+    };
+}
 
+std::vector<FrameWorkQueue::Step> SongLoader::GetRefreshLevelPacksSteps(bool includeDefault, bool force) {
+    std::vector<FrameWorkQueue::Step> steps;
     auto beatmapLevelsModel = GetBeatmapLevelsModel();
-    beatmapLevelsModel->customLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(CustomBeatmapLevelPackCollectionSO);
-    beatmapLevelsModel->UpdateLoadedPreviewLevels();
-    static QuestUI::WeakPtrGO<LevelFilteringNavigationController> levelFilteringNavigationController;
-    if (!levelFilteringNavigationController)
-        levelFilteringNavigationController = Resources::FindObjectsOfTypeAll<LevelFilteringNavigationController*>().FirstOrDefault();
+    // A reloaded menu has a new BeatmapLevelsModel which always needs the packs
+    // Otherwise it's decided once the subscribers ran, they may change the packs too
+    auto commit = std::make_shared<bool>(force || CommittedBeatmapLevelsModel != beatmapLevelsModel || CommittedIncludeDefault != includeDefault);
+    CommittedBeatmapLevelsModel = beatmapLevelsModel;
+    CommittedIncludeDefault = includeDefault;
 
-    if(levelFilteringNavigationController && levelFilteringNavigationController->get_isActiveAndEnabled())
-        levelFilteringNavigationController->UpdateCustomSongs();
+    steps.emplace_back([this, includeDefault, commit] {
+        *commit |= CustomLevelsPack->IsDirty() || CustomWIPLevelsPack->IsDirty();
+        CustomBeatmapLevelPackCollectionSO->BeginUpdate();
+        CustomBeatmapLevelPackCollectionSO->ClearLevelPacks();
+
+        if(includeDefault) {
+            CustomLevelsPack->AddTo(CustomBeatmapLevelPackCollectionSO);
+            CustomWIPLevelsPack->AddTo(CustomBeatmapLevelPackCollectionSO);
+        }
+        CustomLevelsPack->ClearDirty();
+        CustomWIPLevelsPack->ClearDirty();
+
+        // Subscribers get every refresh, even one that doesn't change anything
+        RefreshLevelPacksEvents.Invoke(CustomBeatmapLevelPackCollectionSO);
+
+        // Only rebuilds the packs array once, and only if the packs changed
+        *commit |= CustomBeatmapLevelPackCollectionSO->EndUpdate();
+        if(!*commit)
+            LOG_DEBUG("RefreshLevelPacks Skipped committing, nothing changed");
+        return true;
+    });
+    auto updateLoadedPreviewLevels = MakeUpdateLoadedPreviewLevelsStep(beatmapLevelsModel);
+    steps.emplace_back([this, beatmapLevelsModel, commit, updateLoadedPreviewLevels] {
+        if(!*commit)
+            return true;
+        beatmapLevelsModel->customLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(CustomBeatmapLevelPackCollectionSO);
+        return updateLoadedPreviewLevels();
+    });
+    // A single call into the game's UI that can't be split, it only runs while the level selection is open
+    steps.emplace_back([commit] {
+        if(!*commit)
+            return true;
+        static QuestUI::WeakPtrGO<LevelFilteringNavigationController> levelFilteringNavigationController;
+        if (!levelFilteringNavigationController)
+            levelFilteringNavigationController = Resources::FindObjectsOfTypeAll<LevelFilteringNavigationController*>().FirstOrDefault();
+
+        if(levelFilteringNavigationController && levelFilteringNavigationController->get_isActiveAndEnabled())
+            levelFilteringNavigationController->UpdateCustomSongs();
+        return true;
+    });
+    return steps;
 }
 
-void SongLoader::RefreshSongs(bool fullRefresh, std::function<void(std::vector<CustomPreviewBeatmapLevel*> const&)> const& songsLoaded) {
-    if(IsLoading)
+void SongLoader::RefreshSongs(bool fullRefresh, SongsLoadedCallback const& songsLoaded) {
+    auto now = std::chrono::steady_clock::now();
+    bool inBurst = now - LastRefreshRequest < std::chrono::milliseconds(REFRESH_DEBOUNCE_MS);
+    LastRefreshRequest = now;
+    QueuedRefresh.pending = true;
+    QueuedRefresh.fullRefresh |= fullRefresh;
+    if(songsLoaded)
+        QueuedRefresh.callbacks.push_back(songsLoaded);
+    // A single request starts right away, requests of a burst wait until it's over
+    QueuedRefresh.startAt = inBurst ? now + std::chrono::milliseconds(REFRESH_DEBOUNCE_MS) : now;
+    StartQueuedRefresh();
+}
+
+void SongLoader::StartQueuedRefresh() {
+    if(!QueuedRefresh.pending || QueuedRefresh.waitForMenu || IsLoading || std::chrono::steady_clock::now() < QueuedRefresh.startAt)
         return;
-    SceneManagement::Scene activeScene = SceneManagement::SceneManager::GetActiveScene();
-    
-    if(!activeScene.IsValid() || static_cast<std::string>(activeScene.get_name()).find("Menu") == std::string::npos)
+    if(!StartRefresh(QueuedRefresh.fullRefresh, QueuedRefresh.callbacks)) {
+        QueuedRefresh.waitForMenu = true;
         return;
+    }
+    if(QueuedRefresh.callbacks.size() > 1)
+        LOG_INFO("Merged %d refresh requests", (int) QueuedRefresh.callbacks.size());
+    QueuedRefresh = {};
+}
+
+bool SongLoader::StartRefresh(bool fullRefresh, std::vector<SongsLoadedCallback> const& callbacks) {
+    // Outside the menu the songs are scanned throttled in the background and committed once the menu is back
+    bool background = !IsMenuActive();
+    auto backgroundOptions = GetBackgroundScanOptions();
+    if(background && !backgroundOptions.enabled)
+        return false;
 
     IsLoading = true;
+    IsBackgroundScan = background;
     HasLoaded = false;
     CurrentFolder = 0;
 
+    // Characteristics and environments are resolved from the current menu's CustomLevelLoader
+    ResolveUtils::Invalidate();
+
     HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
         (std::function<void()>)[=] {
 
             auto start = std::chrono::high_resolution_clock::now();
 
+            // The first refresh shows the last library right away and checks the folders in a second refresh
+            if(!SnapshotRestoreAttempted && !fullRefresh && !background) {
+                SnapshotRestoreAttempted = true;
+                if(Registry.Empty() && RestoreSnapshot(callbacks))
+                    return;
+            }
+
+            auto previousLevels = LoadedLevels;
+
+            // Unchanged levels keep their objects, so listeners only see the levels that really changed
             if(fullRefresh) {
-                CustomLevels->Clear();
-                CustomWIPLevels->Clear();
+                Registry.MarkAllUnverified();
+                InternUtils::ResetReport();
             }
+            // Strings and sets of removed levels are released on every refresh
+            InternUtils::RemoveCollected();
 
             std::mutex valuesMutex;
             std::vector<std::string> loadedPaths;
 
-            std::vector<std::string> customLevelsFolders = FileUtils::GetFolders(API::GetCustomLevelsPath());
-            std::vector<std::string> customWIPLevelsFolders = FileUtils::GetFolders(API::GetCustomWIPLevelsPath());
-            customLevelsFolders.insert(std::end(customLevelsFolders), std::begin(customWIPLevelsFolders), std::end(customWIPLevelsFolders));
+            // The first scan uses the folders the prescan enumerated while the game was starting
+            std::vector<std::string> customLevelsFolders;
+            if(auto prescannedFolders = Prescan::TakeFolders()) {
+                customLevelsFolders = std::move(*prescannedFolders);
+            } else {
+                customLevelsFolders = FileUtils::GetFolders({ API::GetCustomLevelsPath(), API::GetCustomWIPLevelsPath() }, ZipUtils::ArchiveExtension);
+            }
+
+            std::unique_ptr<ThreadUtils::Throttle> throttle;
+            if(background)
+                throttle = std::make_unique<ThreadUtils::Throttle>(backgroundOptions.cpuShare, backgroundOptions.maxBytesPerSecond);
 
             MaxFolders = customLevelsFolders.size();
-            std::atomic_int threadsFinished = 0;
-            std::atomic_int index = 0;
-            int threadsCount = std::min(MaxFolders, MAX_THREADS);
-            for(int threadIndex = 0; threadIndex < threadsCount; threadIndex++) {
-                HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
-                    (std::function<void()>)[this, &index, &customLevelsFolders, &threadsFinished, &loadedPaths, &valuesMutex] {
-                        int i = index++;
-                        while(i < MaxFolders) {
-                            std::string const& songPath = customLevelsFolders[i];
-                            LOG_INFO("Loading %s ...", songPath.c_str());
-                            try {
-                                auto startLevel = std::chrono::high_resolution_clock::now(); 
-                                bool wip = songPath.find(CustomWIPLevelsFolder) != std::string::npos;
-                                
-                                CustomPreviewBeatmapLevel* level = nullptr;
-                                auto songPathCS = StringW(songPath);
-                                bool containsKey = CustomLevels->ContainsKey(songPathCS);
-                                if(containsKey) {
-                                    level = reinterpret_cast<CustomPreviewBeatmapLevel*>(CustomLevels->get_Item(songPathCS));
-                                } else {
-                                    containsKey = CustomWIPLevels->ContainsKey(songPathCS);
-                                    if(containsKey) 
-                                        level = reinterpret_cast<CustomPreviewBeatmapLevel*>(CustomWIPLevels->get_Item(songPathCS));
-                                }
-                                if(!level) {
-                                    CustomJSONData::CustomLevelInfoSaveData* saveData = GetStandardLevelInfoSaveData(songPath);
-                                    std::string hash;
-                                    level = LoadCustomPreviewBeatmapLevel(songPath, wip, saveData, hash);
-                                }
-                                if(level) { 
-                                    std::lock_guard<std::mutex> lock(valuesMutex);
-                                    if(!containsKey) {
-                                        if(wip) {
-                                            CustomWIPLevels->Add(songPathCS, level);
-                                        } else {
-                                            CustomLevels->Add(songPathCS, level);
-                                        }
-                                    }
-                                    loadedPaths.push_back(songPath);
-                                    CurrentFolder++;
-                                    std::chrono::milliseconds durationLevel = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startLevel);
-                                    LOG_INFO("Loaded %s in %dms!", songPath.c_str(), (int)durationLevel.count());
-                                } else {
-                                    LOG_ERROR("Failed loading %s!", songPath.c_str());
-                                }
-                            } catch (...) {
-                                LOG_ERROR("Failed loading %s!", songPath.c_str());
-                            }
-                            i = index++;
+            RunParallel(MaxFolders, [this, &customLevelsFolders, &loadedPaths, &valuesMutex, &throttle](int i) {
+                std::string const& songPath = customLevelsFolders[i];
+                LOG_INFO("Loading %s ...", songPath.c_str());
+                auto startLevel = std::chrono::high_resolution_clock::now(); 
+                // Levels that are kept only had their folder listed, they don't count against the read budget
+                bool loaded = false;
+                try {
+                    bool wip = songPath.find(CustomWIPLevelsFolder) != std::string::npos;
+                    
+                    CustomPreviewBeatmapLevel* level = Registry.Find(songPath);
+                    // Levels restored from the snapshot or kept by a full refresh get reloaded if their folder changed since
+                    if(level && !Registry.IsVerified(songPath)) {
+                        auto directoryHash = Registry.GetDirectoryHash(songPath);
+                        if(directoryHash.has_value() && HashUtils::GetDirectoryHash(songPath) == directoryHash) {
+                            Registry.MarkVerified(songPath);
+                        } else {
+                            Registry.Remove(songPath);
+                            level = nullptr;
                         }
-                        threadsFinished++;
                     }
-                ), nullptr)->Run();
-            }
-            //Wait for threads to finish
-            while(threadsFinished < threadsCount) {
-                Thread::Yield();
-            }
+                    if(!level) {
+                        std::string hash;
+                        loaded = true;
+                        level = LoadCustomPreviewBeatmapLevel(songPath, wip, hash);
+                        if(level)
+                            level = Registry.TryAdd(songPath, wip, level, static_cast<std::string>(level->levelID), GetCachedDirectoryHash(songPath));
+                    }
+                    if(level) { 
+                        std::lock_guard<std::mutex> lock(valuesMutex);
+                        loadedPaths.push_back(songPath);
+                        CurrentFolder++;
+                        std::chrono::milliseconds durationLevel = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startLevel);
+                        LOG_INFO("Loaded %s in %dms!", songPath.c_str(), (int)durationLevel.count());
+                    } else {
+                        LOG_ERROR("Failed loading %s!", songPath.c_str());
+                    }
+                } catch (...) {
+                    LOG_ERROR("Failed loading %s!", songPath.c_str());
+                }
+                if(throttle)
+                    throttle->Pace(std::chrono::high_resolution_clock::now() - startLevel, loaded ? GetLoadedDataFilesSize(songPath) : 0);
+            }, background ? LoadPriority::Background : LoadPriority::Refresh);
+
+            // Drop levels whose folders got removed or can't be loaded anymore
+            Registry.RemoveExcept(loadedPaths);
 
-            auto customPreviewLevels = GetDictionaryValues(CustomLevels);
-            auto customWIPPreviewLevels = GetDictionaryValues(CustomWIPLevels);
+            auto customPreviewLevels = Registry.GetLevels(false);
+            auto customWIPPreviewLevels = Registry.GetLevels(true);
 
-            CustomLevelsPack->SetCustomPreviewBeatmapLevels(customPreviewLevels);
-            CustomWIPLevelsPack->SetCustomPreviewBeatmapLevels(customWIPPreviewLevels);
+            CustomLevelsPack->SetCustomPreviewBeatmapLevels(ToArrayW(customPreviewLevels));
+            CustomWIPLevelsPack->SetCustomPreviewBeatmapLevels(ToArrayW(customWIPPreviewLevels));
 
-            int levelsCount = customPreviewLevels.Length() + customWIPPreviewLevels.Length();
+            int levelsCount = customPreviewLevels.size() + customWIPPreviewLevels.size();
             
             auto duration = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start); 
             
-            LoadingUI::UpdateLoadedProgress(levelsCount, duration.count());
+            if(!background)
+                LoadingUI::UpdateLoadedProgress(levelsCount, duration.count());
             LOG_INFO("Loaded %d songs in %dms!", levelsCount, (int)duration.count());
+            auto internReport = InternUtils::GetReport();
+            LOG_INFO("Shared %d strings and %d difficulty set lists, saved %dKB!", (int)internReport.sharedStrings, (int)internReport.sharedPreviewDifficultyBeatmapSetLists, (int)(internReport.bytesSaved / 1024));
             
             LoadedLevels.clear();
             LoadedLevels.insert(LoadedLevels.end(), customPreviewLevels.begin(), customPreviewLevels.end());
             LoadedLevels.insert(LoadedLevels.end(), customWIPPreviewLevels.begin(), customWIPPreviewLevels.end());
-            
-            QuestUI::MainThreadScheduler::Schedule(
-                [this, songsLoaded] {
-                    
-                    RefreshLevelPacks(true);
-
-                    IsLoading = false;
-                    HasLoaded = true;
 
-                    if(songsLoaded)
-                        songsLoaded(LoadedLevels);
+            SearchUtils::SetLevels(LoadedLevels);
 
-                    std::lock_guard<std::mutex> lock(LoadedEventsMutex);
-                    for (auto& event : LoadedEvents) {
-                        event(LoadedLevels);
+            auto changeSet = std::make_shared<LevelsChangeSet>(GetLevelsChangeSet(previousLevels, LoadedLevels));
+            auto snapshotLevels = LoadedLevels;
+            
+            QuestUI::MainThreadScheduler::Schedule(
+                [this, callbacks, changeSet] {
+                    // Committing touches the game's level packs, outside the menu it waits for MenuLoaded
+                    if(!IsMenuActive()) {
+                        PendingCommit = [this, callbacks, changeSet] {
+                            CommitRefresh(callbacks, changeSet);
+                        };
+                        return;
                     }
+                    CommitRefresh(callbacks, changeSet);
                 }
             );
 
             CacheUtils::SaveToFile(loadedPaths);
+            // The snapshot on disk still matches when no level was added, removed or reloaded
+            if(!changeSet->Empty())
+                SaveSnapshot(snapshotLevels);
         }
     ), nullptr)->Run();
+    return true;
+}
+
+bool SongLoader::RestoreSnapshot(std::vector<SongsLoadedCallback> const& callbacks) {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto prescannedSnapshot = Prescan::TakeSnapshot();
+    auto snapshot = prescannedSnapshot.has_value() ? std::move(*prescannedSnapshot) : SnapshotUtils::Load(GetBaseLevelsPath() + LibrarySnapshotFile);
+    if(snapshot.empty())
+        return false;
+
+    std::vector<CustomPreviewBeatmapLevel*> levels(snapshot.size());
+    std::mutex progressMutex;
+    MaxFolders = snapshot.size();
+    RunParallel(snapshot.size(), [this, &snapshot, &levels, &progressMutex](int i) {
+        auto& record = snapshot[i];
+        try {
+            auto standardLevelInfoSaveData = ParseStandardLevelInfoSaveData(record.infoText, record.path);
+            if(!standardLevelInfoSaveData)
+                return;
+            auto level = CreateCustomPreviewBeatmapLevel(record.path, record.wip, GetLevelInfo(standardLevelInfoSaveData), standardLevelInfoSaveData, record.hash);
+            level->songDuration = record.songDuration;
+            // Later refreshes find the hash and duration without reading the folder again
+            if(!CacheUtils::PeekCacheData(record.path).has_value())
+                CacheUtils::UpdateCacheData(record.path, { record.directoryHash, record.hash, record.songDuration });
+            levels[i] = Registry.TryAdd(record.path, record.wip, level, static_cast<std::string>(level->levelID), record.directoryHash, false);
+            std::lock_guard<std::mutex> lock(progressMutex);
+            CurrentFolder++;
+        } catch (...) {
+            LOG_ERROR("Failed restoring %s!", record.path.c_str());
+        }
+    });
+
+    std::vector<CustomPreviewBeatmapLevel*> customPreviewLevels;
+    std::vector<CustomPreviewBeatmapLevel*> customWIPPreviewLevels;
+    for(int i = 0; i < snapshot.size(); i++) {
+        if(levels[i])
+            (snapshot[i].wip ? customWIPPreviewLevels : customPreviewLevels).push_back(levels[i]);
+    }
+    CustomLevelsPack->SetCustomPreviewBeatmapLevels(ToArrayW(customPreviewLevels));
+    CustomWIPLevelsPack->SetCustomPreviewBeatmapLevels(ToArrayW(customWIPPreviewLevels));
+
+    LoadedLevels.clear();
+    LoadedLevels.insert(LoadedLevels.end(), customPreviewLevels.begin(), customPreviewLevels.end());
+    LoadedLevels.insert(LoadedLevels.end(), customWIPPreviewLevels.begin(), customWIPPreviewLevels.end());
+
+    SearchUtils::SetLevels(LoadedLevels);
+
+    auto changeSet = std::make_shared<LevelsChangeSet>(GetLevelsChangeSet({}, LoadedLevels));
+
+    auto duration = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    LoadingUI::UpdateLoadedProgress(LoadedLevels.size(), duration.count());
+    LOG_INFO("Restored %d songs from the snapshot in %dms!", (int)LoadedLevels.size(), (int)duration.count());
+
+    QuestUI::MainThreadScheduler::Schedule(
+        [this, callbacks, changeSet] {
+            CommitRefresh(callbacks, changeSet);
+            // Picks up changed, new and removed folders once the restored levels are committed
+            RefreshSongs(false);
+        }
+    );
+    return true;
+}
+
+void SongLoader::SaveSnapshot(std::vector<CustomPreviewBeatmapLevel*> const& levels) {
+    std::vector<SnapshotUtils::SnapshotLevel> snapshot;
+    snapshot.reserve(levels.size());
+    for(auto level : levels) {
+        std::string path = static_cast<std::string>(level->customLevelPath);
+        auto cacheData = CacheUtils::PeekCacheData(path);
+        if(!cacheData.has_value() || !cacheData->sha1.has_value())
+            continue;
+        auto& record = snapshot.emplace_back();
+        record.wip = path.find(CustomWIPLevelsFolder) != std::string::npos;
+        record.hash = *cacheData->sha1;
+        record.path = std::move(path);
+        record.directoryHash = cacheData->directoryHash;
+        record.songDuration = level->songDuration;
+    }
+    SnapshotUtils::Save(GetBaseLevelsPath() + LibrarySnapshotFile, std::move(snapshot));
+}
+
+void SongLoader::CommitRefresh(std::vector<SongsLoadedCallback> const& callbacks, std::shared_ptr<LevelsChangeSet> const& changeSet) {
+    IsBackgroundScan = false;
+    // Spread over frames so big libraries don't stall the menu
+    IsCommitting = true;
+    CommitQueue.EnqueueResumable(GetRefreshLevelPacksSteps(true, false));
+    // The callbacks get a copy, like the events, the next refresh refills LoadedLevels on its worker
+    auto loadedLevels = std::make_shared<std::vector<CustomPreviewBeatmapLevel*>>(LoadedLevels);
+    for(auto& songsLoaded : callbacks) {
+        CommitQueue.Enqueue([loadedLevels, songsLoaded] {
+            songsLoaded(*loadedLevels);
+        });
+    }
+    CommitQueue.Enqueue(LoadedEvents.MakeInvokeSteps(*loadedLevels));
+    CommitQueue.Enqueue(LevelsChangedEvents.MakeInvokeSteps(*changeSet));
+    auto finished = std::make_shared<bool>(false);
+    CommitQueue.EnqueueResumable([this, finished] {
+        // No queued refresh can start before every step above ran
+        if(!*finished) {
+            *finished = true;
+            IsLoading = false;
+            HasLoaded = true;
+        }
+        // A new refresh took over, it commits the rest once it's done
+        if(DeferredCommits.empty() || IsLoading) {
+            IsCommitting = false;
+            return true;
+        }
+        auto commit = std::move(DeferredCommits.front());
+        DeferredCommits.erase(DeferredCommits.begin());
+        commit();
+        return false;
+    });
+}
+
+std::vector<CustomPreviewBeatmapLevel*> SongLoader::RemoveLoadedLevels(std::vector<std::string> const& paths) {
+    std::vector<CustomPreviewBeatmapLevel*> removedLevels;
+    std::unordered_set<CustomPreviewBeatmapLevel*> removedCustomLevels;
+    std::unordered_set<CustomPreviewBeatmapLevel*> removedCustomWIPLevels;
+    for(auto& path : paths) {
+        CacheUtils::RemoveCacheData(path);
+        bool wip = false;
+        CustomPreviewBeatmapLevel* level = Registry.Remove(path, &wip);
+        if(level) {
+            (wip ? removedCustomWIPLevels : removedCustomLevels).insert(level);
+            SearchUtils::RemoveLevel(level);
+        }
+        removedLevels.push_back(level);
+    }
+    if(removedCustomLevels.empty() && removedCustomWIPLevels.empty())
+        return removedLevels;
+    std::erase_if(LoadedLevels, [&](auto level) { return removedCustomLevels.contains(level) || removedCustomWIPLevels.contains(level); });
+    // The packs keep the order of the remaining levels so this doesn't resort anything
+    for(auto [pack, removed] : { std::make_pair(CustomLevelsPack, &removedCustomLevels), std::make_pair(CustomWIPLevelsPack, &removedCustomWIPLevels) }) {
+        if(removed->empty())
+            continue;
+        std::vector<CustomPreviewBeatmapLevel*> remainingLevels;
+        for(auto level : pack->GetCustomPreviewBeatmapLevels()) {
+            if(!removed->contains(level))
+                remainingLevels.push_back(level);
+        }
+        pack->SetCustomPreviewBeatmapLevels(ToArrayW(remainingLevels));
+    }
+    return removedLevels;
+}
+
+void SongLoader::AddLoadedLevels(std::vector<SongOperationStatus>& statuses) {
+    std::vector<CustomPreviewBeatmapLevel*> addedCustomLevels;
+    std::vector<CustomPreviewBeatmapLevel*> addedCustomWIPLevels;
+    // A refresh that ran since the levels were registered already added them
+    std::unordered_set<CustomPreviewBeatmapLevel*> loadedLevels(LoadedLevels.begin(), LoadedLevels.end());
+    for(auto& status : statuses) {
+        if(status.result != SongOperationResult::Success || loadedLevels.contains(status.level))
+            continue;
+        if(status.path.find(CustomWIPLevelsFolder) != std::string::npos)
+            addedCustomWIPLevels.push_back(status.level);
+        else
+            addedCustomLevels.push_back(status.level);
+        LoadedLevels.push_back(status.level);
+        SearchUtils::AddLevel(status.level);
+    }
+    // Only the added levels get sorted, they are merged into the existing orderings
+    for(auto [pack, added] : { std::make_pair(CustomLevelsPack, &addedCustomLevels), std::make_pair(CustomWIPLevelsPack, &addedCustomWIPLevels) }) {
+        if(added->empty())
+            continue;
+        auto oldLevels = pack->GetCustomPreviewBeatmapLevels();
+        std::vector<CustomPreviewBeatmapLevel*> levels(oldLevels.begin(), oldLevels.end());
+        levels.insert(levels.end(), added->begin(), added->end());
+        pack->SetCustomPreviewBeatmapLevels(ToArrayW(levels));
+    }
+}
+
+void SongLoader::CommitWhenIdle(std::function<void()> const& commit) {
+    // The running refresh builds the packs and loaded levels from its own snapshot and would overwrite the changes
+    if(IsLoading || IsCommitting)
+        DeferredCommits.push_back(commit);
+    else
+        commit();
 }
 
 void SongLoader::DeleteSong(std::string_view path, std::function<void()> const& finished) {
+    DeleteSongs({ std::string(path) }, 
+        [finished](std::vector<SongOperationStatus> const&) {
+            if(finished)
+                finished();
+        }
+    );
+}
+
+void SongLoader::DeleteSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished) {
     HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
-        (std::function<void()>)[this, path, finished] {
-            FileUtils::DeleteFolder(path);
-            auto songPathCS = StringW(path);
-            CustomLevels->Remove(songPathCS);
-            CustomWIPLevels->Remove(songPathCS);
-            LOG_INFO("Deleted Song %s!", path.data());
+        (std::function<void()>)[this, paths, finished] {
+            auto statuses = std::make_shared<std::vector<SongOperationStatus>>(paths.size());
+            std::vector<std::optional<std::string>> trashPaths(paths.size());
+            auto trashPath = GetTrashPath();
+            // Renaming is instant, the files are only removed after the levels are gone from the game
+            RunParallel(paths.size(), [&paths, &statuses, &trashPaths, &trashPath](int i) {
+                auto& status = (*statuses)[i];
+                status.path = paths[i];
+                while(status.path.ends_with('/'))
+                    status.path.pop_back();
+                if(!LevelExists(status.path)) {
+                    status.result = SongOperationResult::NotFound;
+                    return;
+                }
+                trashPaths[i] = FileUtils::MoveToTrash(status.path, trashPath);
+                if(trashPaths[i].has_value() || FileUtils::DeleteFolder(status.path)) {
+                    status.result = SongOperationResult::Success;
+                    LOG_INFO("Deleted Song %s!", status.path.c_str());
+                } else {
+                    status.result = SongOperationResult::Failed;
+                }
+            });
             QuestUI::MainThreadScheduler::Schedule(
-                [this, &finished] {
-                    std::lock_guard<std::mutex> lock(SongDeletedEventsMutex);
-                    for (auto& event : SongDeletedEvents) {
-                        event();
+                [this, statuses, finished] {
+                    CommitWhenIdle([this, statuses, finished] {
+                        std::vector<std::string> deletedPaths;
+                        for(auto& status : *statuses) {
+                            if(status.result == SongOperationResult::Success)
+                                deletedPaths.push_back(status.path);
+                        }
+                        auto levels = RemoveLoadedLevels(deletedPaths);
+                        for(int i = 0, j = 0; i < statuses->size(); i++) {
+                            if((*statuses)[i].result == SongOperationResult::Success)
+                                (*statuses)[i].level = levels[j++];
+                        }
+                        RefreshLevelPacks(true, false);
+                        LevelsChangeSet changeSet;
+                        for(auto level : levels) {
+                            SongDeletedEvents.Invoke(level);
+                            if(level)
+                                changeSet.removed.push_back(MakeLevelChange(level));
+                        }
+                        if(!changeSet.Empty())
+                            LevelsChangedEvents.Invoke(changeSet);
+                        if(finished)
+                            finished(*statuses);
+                    });
+                }
+            );
+            for(auto& path : trashPaths) {
+                if(path.has_value())
+                    FileUtils::DeleteFolder(*path);
+            }
+        }
+    ), nullptr)->Run();
+}
+
+void SongLoader::AddSongs(std::vector<std::string> const& paths, std::function<void(std::vector<SongOperationStatus> const&)> const& finished) {
+    HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
+        (std::function<void()>)[this, paths, finished] {
+            auto statuses = std::make_shared<std::vector<SongOperationStatus>>(paths.size());
+            RunParallel(paths.size(), [this, &paths, &statuses](int i) {
+                auto& status = (*statuses)[i];
+                status.path = paths[i];
+                while(status.path.ends_with('/'))
+                    status.path.pop_back();
+                if(!LevelExists(status.path)) {
+                    status.result = SongOperationResult::NotFound;
+                    return;
+                }
+                try {
+                    bool wip = status.path.find(CustomWIPLevelsFolder) != std::string::npos;
+                    std::string hash;
+                    status.level = LoadCustomPreviewBeatmapLevel(status.path, wip, hash);
+                } catch (...) {
+                    status.level = nullptr;
+                }
+                if(status.level) {
+                    // Registering right away keeps the level alive until it's committed
+                    auto level = Registry.TryAdd(status.path, status.path.find(CustomWIPLevelsFolder) != std::string::npos, status.level, static_cast<std::string>(status.level->levelID), GetCachedDirectoryHash(status.path));
+                    if(level != status.level) {
+                        status.result = SongOperationResult::AlreadyLoaded;
+                        status.level = level;
+                        return;
                     }
-                    finished();
+                    status.result = SongOperationResult::Success;
+                    LOG_INFO("Loaded %s!", status.path.c_str());
+                } else {
+                    status.result = SongOperationResult::Failed;
+                    LOG_ERROR("Failed loading %s!", status.path.c_str());
+                }
+            });
+            QuestUI::MainThreadScheduler::Schedule(
+                [this, statuses, finished] {
+                    CommitWhenIdle([this, statuses, finished] {
+                        AddLoadedLevels(*statuses);
+                        RefreshLevelPacks(true, false);
+                        LevelsChangeSet changeSet;
+                        for(auto& status : *statuses) {
+                            if(status.result == SongOperationResult::Success)
+                                changeSet.added.push_back(MakeLevelChange(status.level));
+                        }
+                        if(!changeSet.Empty())
+                            LevelsChangedEvents.Invoke(changeSet);
+                        if(finished)
+                            finished(*statuses);
+                    });
                 }
             );
         }
@@ -18,22 +18,60 @@ SongLoaderBeatmapLevelPackCollectionSO* SongLoaderBeatmapLevelPackCollectionSO::
 void SongLoaderBeatmapLevelPackCollectionSO::AddLevelPack(CustomBeatmapLevelPack* pack) {
     if(pack && !customBeatmapLevelPacks->Contains(pack)) {
         customBeatmapLevelPacks->Add(pack);
-        UpdateArray();
+        isDirty = true;
+        if(updateDepth <= 0)
+            UpdateArray();
     }
 }
 
 void SongLoaderBeatmapLevelPackCollectionSO::RemoveLevelPack(CustomBeatmapLevelPack* pack) {
     if(pack && customBeatmapLevelPacks->Contains(pack)) {
         customBeatmapLevelPacks->Remove(pack);
-        UpdateArray();
+        isDirty = true;
+        if(updateDepth <= 0)
+            UpdateArray();
     }
 }
 
 void SongLoaderBeatmapLevelPackCollectionSO::ClearLevelPacks() {
     customBeatmapLevelPacks->Clear();
-    UpdateArray();
+    isDirty = true;
+    if(updateDepth <= 0)
+        UpdateArray();
 }
 
 void SongLoaderBeatmapLevelPackCollectionSO::UpdateArray() {
+    isDirty = false;
     allBeatmapLevelPacks = ArrayW<IBeatmapLevelPack*>(reinterpret_cast<Array<IBeatmapLevelPack*>*>(customBeatmapLevelPacks->ToArray().convert()));
+}
+
+bool SongLoaderBeatmapLevelPackCollectionSO::IsArrayUpToDate() {
+    if(!allBeatmapLevelPacks)
+        return false;
+    int count = customBeatmapLevelPacks->get_Count();
+    if(allBeatmapLevelPacks.Length() != count)
+        return false;
+    for(int i = 0; i < count; i++) {
+        if(allBeatmapLevelPacks[i] != reinterpret_cast<IBeatmapLevelPack*>(customBeatmapLevelPacks->get_Item(i)))
+            return false;
+    }
+    return true;
+}
+
+void SongLoaderBeatmapLevelPackCollectionSO::BeginUpdate() {
+    updateDepth++;
+}
+
+bool SongLoaderBeatmapLevelPackCollectionSO::EndUpdate() {
+    if(updateDepth > 0)
+        updateDepth--;
+    if(updateDepth > 0 || !isDirty)
+        return false;
+    // Clearing and re-adding the same packs doesn't need a new array
+    if(IsArrayUpToDate()) {
+        isDirty = false;
+        return false;
+    }
+    UpdateArray();
+    return true;
 }
\ No newline at end of file
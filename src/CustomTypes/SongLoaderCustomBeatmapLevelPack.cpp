@@ -1,9 +1,14 @@
 #include "CustomTypes/SongLoaderCustomBeatmapLevelPack.hpp"
 
 #include "Paths.hpp"
+#include "Utils/CacheUtils.hpp"
 #include "Utils/FindComponentsUtils.hpp"
+#include "Utils/StringUtils.hpp"
 
-#include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp" 
+#include "GlobalNamespace/CustomPreviewBeatmapLevel.hpp"
+
+#include <algorithm>
+#include <unordered_map>
 
 using namespace RuntimeSongLoader;
 using namespace GlobalNamespace;
@@ -16,22 +21,83 @@ constexpr ArrayW<T> listToArrayW(::System::Collections::Generic::IReadOnlyList_1
     return ArrayW<T>(reinterpret_cast<Array<T>*>(list));
 }
 
+std::u16string FoldCase(StringW text) {
+    if(!text)
+        return u"";
+    return StringUtils::FoldCase(text);
+}
+
+// The scan listed the level's files for its cache data already, so this never touches the disk
+int64_t GetDateAdded(StringW customLevelPath) {
+    if(!customLevelPath)
+        return 0;
+    auto cacheData = CacheUtils::PeekCacheData(static_cast<std::string>(customLevelPath));
+    return cacheData.has_value() ? cacheData->lastWriteTime : 0;
+}
+
+LevelSortKey CreateSortKey(CustomPreviewBeatmapLevel* level) {
+    LevelSortKey key;
+    key.level = level;
+    key.songName = FoldCase(level->songName);
+    key.levelAuthorName = FoldCase(level->levelAuthorName);
+    key.dateAdded = GetDateAdded(level->customLevelPath);
+    key.songDuration = level->songDuration;
+    key.beatsPerMinute = level->beatsPerMinute;
+    return key;
+}
+
+bool CompareSortKeys(SortMode mode, LevelSortKey const& first, LevelSortKey const& second) {
+    switch(mode) {
+        case SortMode::DateAdded:
+            if(first.dateAdded != second.dateAdded)
+                return first.dateAdded > second.dateAdded;
+            break;
+        case SortMode::Duration:
+            if(first.songDuration != second.songDuration)
+                return first.songDuration < second.songDuration;
+            break;
+        case SortMode::BeatsPerMinute:
+            if(first.beatsPerMinute != second.beatsPerMinute)
+                return first.beatsPerMinute < second.beatsPerMinute;
+            break;
+        case SortMode::LevelAuthor:
+            if(first.levelAuthorName != second.levelAuthorName)
+                return first.levelAuthorName < second.levelAuthorName;
+            break;
+        default:
+            break;
+    }
+    if(first.songName != second.songName)
+        return first.songName < second.songName;
+    return first.levelAuthorName < second.levelAuthorName;
+}
+
 SongLoaderCustomBeatmapLevelPack* SongLoaderCustomBeatmapLevelPack::Make_New(std::string const& packID, std::string_view packName, Sprite* coverImage) {
     return SongLoaderCustomBeatmapLevelPack::New_ctor(StringW(CustomLevelPackPrefixID + packID), StringW(packName), coverImage);
 }
 
 void SongLoaderCustomBeatmapLevelPack::ctor(StringW packID, StringW packName, Sprite* coverImage) {
+    INVOKE_CTOR();
     CustomLevelsCollection = CustomBeatmapLevelCollection::New_ctor(ArrayW<CustomPreviewBeatmapLevel*>());
     auto newCoverImage = coverImage ? coverImage : FindComponentsUtils::GetCustomLevelLoader()->defaultPackCover;
     CustomLevelsPack = CustomBeatmapLevelPack::New_ctor(packID, packName, packName, newCoverImage, newCoverImage, CustomLevelsCollection);
 }
 
 void SongLoaderCustomBeatmapLevelPack::SortLevels() {
-    auto array = listToArrayW<CustomPreviewBeatmapLevel*>(CustomLevelsCollection->customPreviewBeatmapLevels);
-    if(!array)
-        return;
-    if(array.Length() > 0)
-        std::sort(array.begin(), array.end(), [](CustomPreviewBeatmapLevel* first, CustomPreviewBeatmapLevel* second) { return first->songName < second->songName; } );
+    // The collection is sorted by SetCustomPreviewBeatmapLevels already, on the refresh worker instead of the main thread
+}
+
+ArrayW<CustomPreviewBeatmapLevel*> SongLoaderCustomBeatmapLevelPack::GetSortedLevelsUnsafe(SortMode mode) {
+    auto& ordering = orderings[static_cast<std::size_t>(mode)];
+    auto array = ArrayW<CustomPreviewBeatmapLevel*>(ordering.size());
+    for(std::size_t i = 0; i < ordering.size(); i++)
+        array[i] = sortKeys[ordering[i]].level;
+    return array;
+}
+
+ArrayW<CustomPreviewBeatmapLevel*> SongLoaderCustomBeatmapLevelPack::GetSortedLevels(SortMode mode) {
+    std::lock_guard<std::mutex> lock(sortMutex);
+    return GetSortedLevelsUnsafe(mode);
 }
 
 ArrayW<CustomPreviewBeatmapLevel*> SongLoaderCustomBeatmapLevelPack::GetCustomPreviewBeatmapLevels() {
@@ -39,7 +105,68 @@ ArrayW<CustomPreviewBeatmapLevel*> SongLoaderCustomBeatmapLevelPack::GetCustomPr
 }
 
 void SongLoaderCustomBeatmapLevelPack::SetCustomPreviewBeatmapLevels(ArrayW<CustomPreviewBeatmapLevel*> customPreviewBeatmapLevels) {
-    CustomLevelsCollection->customPreviewBeatmapLevels = reinterpret_cast<::System::Collections::Generic::IReadOnlyList_1<CustomPreviewBeatmapLevel*>*>(customPreviewBeatmapLevels.convert());
+    std::lock_guard<std::mutex> lock(sortMutex);
+    // Keys of levels that stay in the pack are reused, only new levels touch il2cpp strings
+    std::unordered_map<CustomPreviewBeatmapLevel*, uint32_t> oldIndices;
+    oldIndices.reserve(sortKeys.size());
+    for(uint32_t i = 0; i < sortKeys.size(); i++)
+        oldIndices.emplace(sortKeys[i].level, i);
+    std::vector<CustomPreviewBeatmapLevel*> levels;
+    if(customPreviewBeatmapLevels) {
+        levels.reserve(customPreviewBeatmapLevels.Length());
+        for(auto level : customPreviewBeatmapLevels) {
+            if(level)
+                levels.push_back(level);
+        }
+    }
+    // Same levels as before, keep the current (already sorted) array
+    if(levels.size() == sortKeys.size() && std::all_of(levels.begin(), levels.end(), [&oldIndices](auto level) { return oldIndices.contains(level); }))
+        return;
+    std::vector<int64_t> remap(sortKeys.size(), -1);
+    std::vector<LevelSortKey> newSortKeys;
+    std::vector<uint32_t> addedIndices;
+    newSortKeys.reserve(levels.size());
+    for(auto level : levels) {
+        auto search = oldIndices.find(level);
+        if(search != oldIndices.end()) {
+            remap[search->second] = newSortKeys.size();
+            newSortKeys.push_back(std::move(sortKeys[search->second]));
+            oldIndices.erase(search);
+        } else {
+            addedIndices.push_back(newSortKeys.size());
+            newSortKeys.push_back(CreateSortKey(level));
+        }
+    }
+    // Retained levels are already in order, so only the added ones need sorting before a merge
+    for(std::size_t mode = 0; mode < SortModesCount; mode++) {
+        auto compare = [mode, &newSortKeys](uint32_t first, uint32_t second) {
+            return CompareSortKeys(static_cast<SortMode>(mode), newSortKeys[first], newSortKeys[second]);
+        };
+        std::vector<uint32_t> ordering;
+        ordering.reserve(newSortKeys.size());
+        for(auto index : orderings[mode]) {
+            if(remap[index] >= 0)
+                ordering.push_back(remap[index]);
+        }
+        auto retainedCount = ordering.size();
+        ordering.insert(ordering.end(), addedIndices.begin(), addedIndices.end());
+        std::sort(ordering.begin() + retainedCount, ordering.end(), compare);
+        std::inplace_merge(ordering.begin(), ordering.begin() + retainedCount, ordering.end(), compare);
+        orderings[mode] = std::move(ordering);
+    }
+    sortKeys = std::move(newSortKeys);
+    isDirty = true;
+    CustomLevelsCollection->customPreviewBeatmapLevels = reinterpret_cast<::System::Collections::Generic::IReadOnlyList_1<CustomPreviewBeatmapLevel*>*>(GetSortedLevelsUnsafe(SortMode::SongName).convert());
+}
+
+bool SongLoaderCustomBeatmapLevelPack::IsDirty() {
+    std::lock_guard<std::mutex> lock(sortMutex);
+    return isDirty;
+}
+
+void SongLoaderCustomBeatmapLevelPack::ClearDirty() {
+    std::lock_guard<std::mutex> lock(sortMutex);
+    isDirty = false;
 }
 
 void SongLoaderCustomBeatmapLevelPack::AddTo(SongLoaderBeatmapLevelPackCollectionSO* customBeatmapLevelPackCollectionSO, bool addIfEmpty) {
@@ -0,0 +1,79 @@
+#include "FrameWorkQueue.hpp"
+
+#include "CustomLogger.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace RuntimeSongLoader {
+
+    void FrameWorkQueue::Enqueue(std::function<void()> const& step) {
+        EnqueueResumable([step] {
+            step();
+            return true;
+        });
+    }
+
+    void FrameWorkQueue::Enqueue(std::vector<std::function<void()>> const& steps) {
+        for(auto& step : steps)
+            Enqueue(step);
+    }
+
+    void FrameWorkQueue::EnqueueResumable(Step const& step) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        // A new batch starts when the queue was idle
+        if(steps.empty()) {
+            report.frames = 0;
+            report.steps = 0;
+            report.totalMicroseconds = 0;
+            report.worstFrameMicroseconds = 0;
+        }
+        steps.push_back(step);
+        report.pendingSteps = steps.size();
+    }
+
+    void FrameWorkQueue::EnqueueResumable(std::vector<Step> const& steps) {
+        for(auto& step : steps)
+            EnqueueResumable(step);
+    }
+
+    bool FrameWorkQueue::Empty() const {
+        return steps.empty();
+    }
+
+    void FrameWorkQueue::Run() {
+        if(steps.empty())
+            return;
+        auto start = std::chrono::steady_clock::now();
+        auto budget = budgetMicroseconds.load(std::memory_order_relaxed);
+        uint64_t microseconds = 0;
+        uint64_t stepsRun = 0;
+        do {
+            // Steps may queue more steps, references into a deque stay valid on push_back
+            auto& step = steps.front();
+            if(step())
+                steps.pop_front();
+            stepsRun++;
+            microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        } while(!steps.empty() && microseconds < budget);
+        std::lock_guard<std::mutex> lock(reportMutex);
+        report.steps += stepsRun;
+        report.pendingSteps = steps.size();
+        report.frames++;
+        report.totalMicroseconds += microseconds;
+        report.worstFrameMicroseconds = std::max(report.worstFrameMicroseconds, microseconds);
+        report.worstFrameMicrosecondsOverall = std::max(report.worstFrameMicrosecondsOverall, microseconds);
+        if(steps.empty())
+            LOG_INFO("FrameWorkQueue Ran %d steps in %d frames, worst frame took %dus!", (int) report.steps, (int) report.frames, (int) report.worstFrameMicroseconds);
+    }
+
+    void FrameWorkQueue::SetBudget(uint64_t microseconds) {
+        budgetMicroseconds.store(microseconds, std::memory_order_relaxed);
+    }
+
+    FrameWorkReport FrameWorkQueue::GetReport() const {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        return report;
+    }
+
+}
@@ -0,0 +1,125 @@
+#include "LevelRegistry.hpp"
+
+#include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
+
+#include <mutex>
+#include <unordered_set>
+
+using namespace GlobalNamespace;
+
+namespace RuntimeSongLoader {
+
+    LevelRegistry::~LevelRegistry() {
+        Clear();
+    }
+
+    CustomPreviewBeatmapLevel* LevelRegistry::Find(std::string_view path) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto search = entries.find(path);
+        return search != entries.end() ? search->second.level : nullptr;
+    }
+
+    CustomPreviewBeatmapLevel* LevelRegistry::TryAdd(std::string_view path, bool wip, CustomPreviewBeatmapLevel* level, std::string_view levelID, std::optional<int> directoryHash, bool verified) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto [entry, added] = entries.try_emplace(std::string(path));
+        if(!added)
+            return entry->second.level;
+        entry->second.level = level;
+        entry->second.wip = wip;
+        entry->second.levelID = levelID;
+        entry->second.directoryHash = directoryHash;
+        entry->second.verified = verified;
+        entry->second.handle = il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(level), false);
+        levelsById[std::string(levelID)].push_back(level);
+        return level;
+    }
+
+    bool LevelRegistry::IsVerified(std::string_view path) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto search = entries.find(path);
+        return search == entries.end() || search->second.verified;
+    }
+
+    std::optional<int> LevelRegistry::GetDirectoryHash(std::string_view path) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto search = entries.find(path);
+        return search != entries.end() ? search->second.directoryHash : std::nullopt;
+    }
+
+    void LevelRegistry::MarkVerified(std::string_view path) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto search = entries.find(path);
+        if(search != entries.end())
+            search->second.verified = true;
+    }
+
+    void LevelRegistry::MarkAllUnverified() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for(auto& [path, entry] : entries)
+            entry.verified = false;
+    }
+
+    bool LevelRegistry::Empty() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return entries.empty();
+    }
+
+    void LevelRegistry::RemoveUnsafe(StringMap<Entry>::iterator entry) {
+        auto byId = levelsById.find(entry->second.levelID);
+        if(byId != levelsById.end()) {
+            std::erase(byId->second, entry->second.level);
+            if(byId->second.empty())
+                levelsById.erase(byId);
+        }
+        il2cpp_functions::gchandle_free(entry->second.handle);
+        entries.erase(entry);
+    }
+
+    CustomPreviewBeatmapLevel* LevelRegistry::Remove(std::string_view path, bool* wip) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto search = entries.find(path);
+        if(search == entries.end())
+            return nullptr;
+        auto level = search->second.level;
+        if(wip)
+            *wip = search->second.wip;
+        RemoveUnsafe(search);
+        return level;
+    }
+
+    void LevelRegistry::RemoveExcept(std::vector<std::string> const& paths) {
+        std::unordered_set<std::string_view> kept(paths.begin(), paths.end());
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for(auto entry = entries.begin(); entry != entries.end();) {
+            auto current = entry++;
+            if(!kept.contains(current->first))
+                RemoveUnsafe(current);
+        }
+    }
+
+    void LevelRegistry::Clear() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for(auto& [path, entry] : entries)
+            il2cpp_functions::gchandle_free(entry.handle);
+        entries.clear();
+        levelsById.clear();
+    }
+
+    CustomPreviewBeatmapLevel* LevelRegistry::FindById(std::string_view levelID) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto search = levelsById.find(levelID);
+        return search != levelsById.end() ? search->second.front() : nullptr;
+    }
+
+    std::vector<CustomPreviewBeatmapLevel*> LevelRegistry::GetLevels(bool wip) const {
+        std::vector<CustomPreviewBeatmapLevel*> levels;
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        levels.reserve(entries.size());
+        for(auto& [path, entry] : entries) {
+            if(entry.wip == wip)
+                levels.push_back(entry.level);
+        }
+        return levels;
+    }
+
+}
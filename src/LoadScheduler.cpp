@@ -0,0 +1,73 @@
+#include "LoadScheduler.hpp"
+
+#include "CustomLogger.hpp"
+
+#include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
+
+#include "GlobalNamespace/HMTask.hpp"
+#include "System/Action.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace GlobalNamespace;
+
+namespace RuntimeSongLoader::LoadScheduler {
+
+    // Upper limit for a single Yield, a level load never takes this long unless it hangs
+    #define MAX_YIELD_SECONDS 5
+
+    std::array<int, 3> activeCounts = {};
+    std::mutex activeMutex;
+    std::condition_variable activeChanged;
+
+    bool HasHigherPriorityWork(LoadPriority priority) {
+        for(int i = 0; i < static_cast<int>(priority); i++) {
+            if(activeCounts[i] > 0)
+                return true;
+        }
+        return false;
+    }
+
+    void Begin(LoadPriority priority) {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        activeCounts[static_cast<int>(priority)]++;
+    }
+
+    void End(LoadPriority priority) {
+        {
+            std::lock_guard<std::mutex> lock(activeMutex);
+            activeCounts[static_cast<int>(priority)]--;
+        }
+        activeChanged.notify_all();
+    }
+
+    void Yield(LoadPriority priority) {
+        std::unique_lock<std::mutex> lock(activeMutex);
+        if(!HasHigherPriorityWork(priority))
+            return;
+        auto start = std::chrono::steady_clock::now();
+        if(!activeChanged.wait_for(lock, std::chrono::seconds(MAX_YIELD_SECONDS), [priority] { return !HasHigherPriorityWork(priority); }))
+            LOG_WARN("LoadScheduler Stopped yielding after %ds!", MAX_YIELD_SECONDS);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        LOG_DEBUG("LoadScheduler Yielded %dms to higher priority work", (int) duration.count());
+    }
+
+    void Run(LoadPriority priority, std::function<void()> const& work) {
+        Begin(priority);
+        HMTask::New_ctor(il2cpp_utils::MakeDelegate<System::Action*>(classof(System::Action*),
+            (std::function<void()>)[priority, work] {
+                try {
+                    work();
+                } catch(...) {
+                    End(priority);
+                    throw;
+                }
+                End(priority);
+            }
+        ), nullptr)->Run();
+    }
+
+}
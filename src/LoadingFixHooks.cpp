@@ -10,6 +10,7 @@
 #include "LevelData.hpp"
 
 #include "Utils/FindComponentsUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 
 #include "CustomTypes/SongLoaderCustomBeatmapLevelPack.hpp"
 #include "CustomTypes/CustomLevelInfoSaveData.hpp"
@@ -67,8 +68,11 @@
 
 #include "NUnit/Framework/_Assert.hpp"
 
+#include <array>
 #include <map>
-#include <regex>
+#include <mutex>
+#include <tuple>
+#include <unordered_set>
 
 using namespace GlobalNamespace;
 using namespace UnityEngine;
@@ -78,24 +82,88 @@ using namespace Tasks;
 
 namespace RuntimeSongLoader::LoadingFixHooks {
 
+    #define VERSION_SCAN_LENGTH 50
+
+    int ScanNumber(std::u16string_view text, std::size_t& index, int maxDigits) {
+        int value = 0;
+        int digits = 0;
+        while(index < text.size() && digits < maxDigits && text[index] >= u'0' && text[index] <= u'9') {
+            value = value * 10 + (text[index] - u'0');
+            index++;
+            digits++;
+        }
+        return digits > 0 ? value : -1;
+    }
+
+    void SkipWhitespace(std::u16string_view text, std::size_t& index) {
+        while(index < text.size() && (text[index] == u' ' || text[index] == u'\t' || text[index] == u'\r' || text[index] == u'\n'))
+            index++;
+    }
+
+    // Same grammar as "_?version"\s*:\s*"[0-9]+\.[0-9]+\.?[0-9]?" but without copying the json
+    bool ScanVersion(std::u16string_view text, int& major, int& minor, int& build) {
+        constexpr std::u16string_view key = u"version\"";
+        for(auto start = text.find(key); start != std::u16string_view::npos; start = text.find(key, start + 1)) {
+            if(start == 0)
+                continue;
+            auto quote = start - 1;
+            if(text[quote] == u'_' && quote > 0)
+                quote--;
+            if(text[quote] != u'"')
+                continue;
+            std::size_t index = start + key.size();
+            SkipWhitespace(text, index);
+            if(index >= text.size() || text[index++] != u':')
+                continue;
+            SkipWhitespace(text, index);
+            if(index >= text.size() || text[index++] != u'"')
+                continue;
+            major = ScanNumber(text, index, 9);
+            if(major < 0 || index >= text.size() || text[index++] != u'.')
+                continue;
+            minor = ScanNumber(text, index, 9);
+            if(minor < 0 || index >= text.size())
+                continue;
+            bool hasDot = text[index] == u'.';
+            if(hasDot)
+                index++;
+            build = ScanNumber(text, index, 1);
+            if(index >= text.size() || text[index] != u'"')
+                continue;
+            // "1.2." is matched but isn't a valid version
+            if(hasDot && build < 0)
+                return false;
+            return true;
+        }
+        return false;
+    }
+
+    System::Version* GetCachedVersion(int major, int minor, int build) {
+        static std::mutex versionsMutex;
+        static std::map<std::tuple<int, int, int>, System::Version*> versions;
+        std::lock_guard<std::mutex> lock(versionsMutex);
+        auto& version = versions[{major, minor, build}];
+        if(!version) {
+            // Versions are immutable, so one instance can be handed to every caller
+            if(build >= 0)
+                version = System::Version::New_ctor<il2cpp_utils::CreationType::Manual>(major, minor, build);
+            else
+                version = System::Version::New_ctor<il2cpp_utils::CreationType::Manual>(major, minor);
+        }
+        return version;
+    }
+
     MAKE_HOOK_MATCH(BeatmapSaveDataHelpers_GetVersion, &BeatmapSaveDataHelpers::GetVersion, System::Version*, StringW data) {
         LOG_DEBUG("BeatmapSaveDataHelpers_GetVersion");
-        auto truncatedText = data.operator std::string().substr(0, 50);
-        static const std::regex versionRegex (R"("_?version"\s*:\s*"[0-9]+\.[0-9]+\.?[0-9]?")");
-        std::smatch matches;
-        if(std::regex_search(truncatedText, matches, versionRegex)) {
-            if(matches.size() > 0) {
-                auto version = matches[0].str();
-                version = version.substr(0, version.length()-1);
-                version = version.substr(version.find_last_of("\"")+1, version.length());
-                try {
-                    return System::Version::New_ctor(version);
-                } catch(const std::runtime_error& e) {
-                    LOG_INFO("BeatmapSaveDataHelpers_GetVersion Invalid version: \"%s\"!", version.c_str());
-                }
-            }
+        int major, minor, build;
+        if(data) {
+            Il2CppString* string = data;
+            std::u16string_view text(reinterpret_cast<char16_t const*>(string->chars), std::min(string->length, VERSION_SCAN_LENGTH));
+            if(ScanVersion(text, major, minor, build))
+                return GetCachedVersion(major, minor, build);
         }
-        return System::Version::New_ctor("2.0.0");
+        LOG_DEBUG("BeatmapSaveDataHelpers_GetVersion No valid version, using 2.0.0");
+        return GetCachedVersion(2, 0, 0);
     }
 
     MAKE_HOOK_MATCH(BeatmapDataTransformHelper_CreateTransformedBeatmapData, &BeatmapDataTransformHelper::CreateTransformedBeatmapData, IReadonlyBeatmapData*, IReadonlyBeatmapData* beatmapData, IPreviewBeatmapLevel* beatmapLevel, GameplayModifiers* gameplayModifiers, bool leftHanded, EnvironmentEffectsFilterPreset environmentEffectsFilterPreset, EnvironmentIntensityReductionOptions* environmentIntensityReductionOptions, MainSettingsModelSO* mainSettingsModel) {
@@ -157,13 +225,23 @@ namespace RuntimeSongLoader::LoadingFixHooks {
     MAKE_HOOK_MATCH(LevelSearchViewController_UpdateBeatmapLevelPackCollectionAsync, &LevelSearchViewController::UpdateBeatmapLevelPackCollectionAsync, void, LevelSearchViewController* self) {
         LOG_DEBUG("LevelSearchViewController_UpdateBeatmapLevelPackCollectionAsync");
         static ConstString filterName("allSongs");
-        List_1<IPreviewBeatmapLevel*>* newLevels = List_1<IPreviewBeatmapLevel*>::New_ctor();
         auto levelPacks = self->beatmapLevelPacks;
         if(levelPacks.Length() != 1 || levelPacks[0]->get_packID() != filterName) {
+            std::vector<ArrayW<IPreviewBeatmapLevel*>> packLevels;
+            packLevels.reserve(levelPacks.Length());
+            int levelsCount = 0;
             for(auto levelPack : levelPacks) {
                 auto levels = ArrayW<IPreviewBeatmapLevel*>(reinterpret_cast<Array<IPreviewBeatmapLevel*>*>(reinterpret_cast<BeatmapLevelPack*>(levelPack)->get_beatmapLevelCollection()->get_beatmapLevels()));
+                levelsCount += levels.Length();
+                packLevels.push_back(levels);
+            }
+            // Deduplicate natively instead of List.Contains which made this O(n^2)
+            List_1<IPreviewBeatmapLevel*>* newLevels = List_1<IPreviewBeatmapLevel*>::New_ctor(levelsCount);
+            std::unordered_set<IPreviewBeatmapLevel*> addedLevels;
+            addedLevels.reserve(levelsCount);
+            for(auto& levels : packLevels) {
                 for(auto level : levels) {
-                    if(!newLevels->Contains(level))
+                    if(addedLevels.insert(level).second)
                         newLevels->Add(level);
                 }
             }
@@ -178,39 +256,113 @@ namespace RuntimeSongLoader::LoadingFixHooks {
 
     MAKE_HOOK_MATCH(BeatmapLevelsModel_ReloadCustomLevelPackCollectionAsync, &BeatmapLevelsModel::ReloadCustomLevelPackCollectionAsync, Task_1<IBeatmapLevelPackCollection*>*, BeatmapLevelsModel* self, CancellationToken cancellationToken) {
         LOG_DEBUG("BeatmapLevelsModel_ReloadCustomLevelPackCollectionAsync");
-        return Task_1<IBeatmapLevelPackCollection*>::New_ctor(self->customLevelPackCollection);
+        static Task_1<IBeatmapLevelPackCollection*>* cachedTask = nullptr;
+        static uint32_t cachedTaskHandle = 0;
+        if(!cachedTask || cachedTask->get_Result() != self->customLevelPackCollection) {
+            if(cachedTaskHandle)
+                il2cpp_functions::gchandle_free(cachedTaskHandle);
+            cachedTask = Task_1<IBeatmapLevelPackCollection*>::New_ctor(self->customLevelPackCollection);
+            cachedTaskHandle = il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(cachedTask), false);
+        }
+        return cachedTask;
+    }
+
+    // Keeps a collection alive for as long as it is cached
+    struct CachedPackCollection {
+        BeatmapLevelPackCollection* collection = nullptr;
+        uint32_t handle = 0;
+
+        void Set(BeatmapLevelPackCollection* newCollection) {
+            if(handle)
+                il2cpp_functions::gchandle_free(handle);
+            collection = newCollection;
+            handle = il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(newCollection), false);
+        }
+    };
+
+    // Keeps the source arrays alive while cached, so a collected array's address can't be reused by a new one and look unchanged
+    struct CachedPackSources {
+        std::array<Array<IBeatmapLevelPack*>*, 3> sources = {};
+        std::array<uint32_t, 3> handles = {};
+
+        void Set(std::array<Array<IBeatmapLevelPack*>*, 3> const& newSources) {
+            for(std::size_t i = 0; i < handles.size(); i++) {
+                if(handles[i])
+                    il2cpp_functions::gchandle_free(handles[i]);
+                handles[i] = newSources[i] ? il2cpp_functions::gchandle_new(reinterpret_cast<Il2CppObject*>(newSources[i]), false) : 0;
+            }
+            sources = newSources;
+        }
+    };
+
+    Array<IBeatmapLevelPack*>* GetBeatmapLevelPacks(IBeatmapLevelPackCollection* collection) {
+        if(!collection)
+            return nullptr;
+        return collection->get_beatmapLevelPacks().convert();
     }
 
     MAKE_HOOK_MATCH(BeatmapLevelsModel_UpdateAllLoadedBeatmapLevelPacks, &BeatmapLevelsModel::UpdateAllLoadedBeatmapLevelPacks, void, BeatmapLevelsModel* self) {
         LOG_DEBUG("BeatmapLevelsModel_UpdateAllLoadedBeatmapLevelPacks");
-        List<IBeatmapLevelPack*>* list = List<IBeatmapLevelPack*>::New_ctor();
-        if(self->ostAndExtrasPackCollection)
-            list->AddRange(reinterpret_cast<IEnumerable_1<IBeatmapLevelPack*>*>(self->ostAndExtrasPackCollection->get_beatmapLevelPacks().convert()));
-        if(self->dlcLevelPackCollectionContainer && self->dlcLevelPackCollectionContainer->beatmapLevelPackCollection)
-            list->AddRange(reinterpret_cast<IEnumerable_1<IBeatmapLevelPack*>*>(self->dlcLevelPackCollectionContainer->beatmapLevelPackCollection->get_beatmapLevelPacks().convert()));
-        self->allLoadedBeatmapLevelWithoutCustomLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(BeatmapLevelPackCollection::New_ctor(list->ToArray()));
-        if(self->customLevelPackCollection)
-            list->AddRange(reinterpret_cast<IEnumerable_1<IBeatmapLevelPack*>*>(self->customLevelPackCollection->get_beatmapLevelPacks().convert()));
-        self->allLoadedBeatmapLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(BeatmapLevelPackCollection::New_ctor(list->ToArray()));
+        static CachedPackSources cachedSources;
+        static CachedPackCollection cachedWithoutCustom;
+        static CachedPackCollection cachedAll;
+
+        IBeatmapLevelPackCollection* dlcCollection = self->dlcLevelPackCollectionContainer ? self->dlcLevelPackCollectionContainer->beatmapLevelPackCollection : nullptr;
+        // The packs arrays get replaced whenever a collection changes, so they are enough to tell if the cache is stale
+        std::array<Array<IBeatmapLevelPack*>*, 3> sources = {
+            GetBeatmapLevelPacks(self->ostAndExtrasPackCollection),
+            GetBeatmapLevelPacks(dlcCollection),
+            GetBeatmapLevelPacks(self->customLevelPackCollection)
+        };
+        if(!cachedAll.collection || sources != cachedSources.sources) {
+            LOG_DEBUG("BeatmapLevelsModel_UpdateAllLoadedBeatmapLevelPacks Rebuilding collections");
+            int withoutCustomCount = 0;
+            for(int i = 0; i < 2; i++) {
+                if(sources[i])
+                    withoutCustomCount += sources[i]->Length();
+            }
+            int allCount = withoutCustomCount + (sources[2] ? sources[2]->Length() : 0);
+            ArrayW<IBeatmapLevelPack*> withoutCustom(withoutCustomCount);
+            ArrayW<IBeatmapLevelPack*> all(allCount);
+            int index = 0;
+            for(auto source : sources) {
+                if(!source)
+                    continue;
+                for(auto pack : ArrayW<IBeatmapLevelPack*>(source)) {
+                    if(index < withoutCustomCount)
+                        withoutCustom[index] = pack;
+                    all[index++] = pack;
+                }
+            }
+            cachedWithoutCustom.Set(BeatmapLevelPackCollection::New_ctor(withoutCustom));
+            cachedAll.Set(BeatmapLevelPackCollection::New_ctor(all));
+            cachedSources.Set(sources);
+        }
+        self->allLoadedBeatmapLevelWithoutCustomLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(cachedWithoutCustom.collection);
+        self->allLoadedBeatmapLevelPackCollection = reinterpret_cast<IBeatmapLevelPackCollection*>(cachedAll.collection);
+    }
+
+    // Completed tasks can't change anymore, so the same instance is shared by every caller
+    Task_1<AdditionalContentModel::EntitlementStatus>* GetCompletedEntitlementTask(bool owned) {
+        static auto ownedTask = Task_1<AdditionalContentModel::EntitlementStatus>::New_ctor<il2cpp_utils::CreationType::Manual>(AdditionalContentModel::EntitlementStatus::Owned);
+        static auto notOwnedTask = Task_1<AdditionalContentModel::EntitlementStatus>::New_ctor<il2cpp_utils::CreationType::Manual>(AdditionalContentModel::EntitlementStatus::NotOwned);
+        return owned ? ownedTask : notOwnedTask;
     }
 
     MAKE_HOOK_MATCH(AdditionalContentModel_GetLevelEntitlementStatusAsync, &AdditionalContentModel::GetLevelEntitlementStatusAsync, Task_1<AdditionalContentModel::EntitlementStatus>*, AdditionalContentModel* self, StringW levelId, CancellationToken cancellationToken) {
-        std::string levelIdCpp = levelId;
-        LOG_DEBUG("AdditionalContentModel_GetLevelEntitlementStatusAsync %s", levelIdCpp.c_str());
+        LOG_DEBUG("AdditionalContentModel_GetLevelEntitlementStatusAsync %s", static_cast<std::string>(levelId).c_str());
         if(levelId.starts_with(CustomLevelPrefixID)) {
             auto beatmapLevelsModel = FindComponentsUtils::GetBeatmapLevelsModel();
             bool loaded = beatmapLevelsModel->loadedPreviewBeatmapLevels->ContainsKey(levelId) || beatmapLevelsModel->loadedBeatmapLevels->IsInCache(levelId);
-            return Task_1<AdditionalContentModel::EntitlementStatus>::New_ctor(loaded ? AdditionalContentModel::EntitlementStatus::Owned : AdditionalContentModel::EntitlementStatus::NotOwned);
+            return GetCompletedEntitlementTask(loaded);
         }
         return AdditionalContentModel_GetLevelEntitlementStatusAsync(self, levelId, cancellationToken);
     }
 
     MAKE_HOOK_MATCH(AdditionalContentModel_GetPackEntitlementStatusAsync, &AdditionalContentModel::GetPackEntitlementStatusAsync, Task_1<AdditionalContentModel::EntitlementStatus>*, AdditionalContentModel* self, StringW levelPackId, CancellationToken cancellationToken) {
-        std::string levelPackIdCpp = levelPackId;
-        LOG_DEBUG("AdditionalContentModel_GetPackEntitlementStatusAsync %s", levelPackIdCpp.c_str());
-        
+        LOG_DEBUG("AdditionalContentModel_GetPackEntitlementStatusAsync %s", static_cast<std::string>(levelPackId).c_str());
         if(levelPackId.starts_with(CustomLevelPackPrefixID))
-            return Task_1<AdditionalContentModel::EntitlementStatus>::New_ctor(AdditionalContentModel::EntitlementStatus::Owned);
+            return GetCompletedEntitlementTask(true);
         return AdditionalContentModel_GetPackEntitlementStatusAsync(self, levelPackId, cancellationToken);
     }
 
@@ -221,6 +373,11 @@ namespace RuntimeSongLoader::LoadingFixHooks {
 
     MAKE_HOOK_MATCH(FileHelpers_GetEscapedURLForFilePath, &FileHelpers::GetEscapedURLForFilePath, StringW, StringW filePath) {
         LOG_DEBUG("FileHelpers_GetEscapedURLForFilePath");
+        // Audio and covers of zipped songs are below their zip, the loaders extract them on a worker before asking for the URL
+        if(filePath) {
+            if(auto extractedPath = ZipUtils::ResolveArchiveFilePath(static_cast<std::string>(filePath)))
+                return u"file://" + StringW(*extractedPath);
+        }
         return u"file://" + filePath;
     }
 
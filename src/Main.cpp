@@ -14,9 +14,11 @@
 #include "CustomCharacteristics.hpp"
 #include "LoadingFixHooks.hpp"
 #include "LoadingUI.hpp"
+#include "Prescan.hpp"
 
 #include "Utils/FindComponentsUtils.hpp"
 #include "Utils/CacheUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 
 #include "ModSettingsViewController.hpp"
 #include "CustomTypes/SongLoaderBeatmapLevelPackCollectionSO.hpp"
@@ -47,6 +49,8 @@
 #include "UnityEngine/SceneManagement/SceneManager.hpp"
 #include "System/Action_1.hpp"
 
+#include <thread>
+
 ModInfo modInfo;
 
 Logger& getLogger() {
@@ -92,6 +96,8 @@ MAKE_HOOK_MATCH(SceneManager_Internal_ActiveSceneChanged,
                 FindComponentsUtils::ClearCache();
                 API::RefreshSongs(false);
             }
+            // Songs scanned outside the menu get added now
+            SongLoader::GetInstance()->MenuLoaded();
         } else {
             LoadingUI::SetActive(false);
         }
@@ -110,11 +116,7 @@ ModalView* getDeleteDialogPromptModal(std::u16string const& songName) {
         static ConstString contentName("Content");
         auto deleteButton = BeatSaberUI::CreateUIButton(deleteDialogPromptModal->get_transform(), "Delete", Vector2(-15, -8.25), [] {
             deleteDialogPromptModal->Hide(true, nullptr);
-            RuntimeSongLoader::API::DeleteSong(static_cast<std::string>(selectedlevel->customLevelPath), 
-                [] {
-                    RuntimeSongLoader::API::RefreshSongs(false);
-                }
-            );
+            RuntimeSongLoader::API::DeleteSong(static_cast<std::string>(selectedlevel->customLevelPath));
         });
         Object::Destroy(deleteButton->get_transform()->Find(contentName)->GetComponent<LayoutElement*>());
         auto cancelButton = BeatSaberUI::CreateUIButton(deleteDialogPromptModal->get_transform(), "Cancel", Vector2(15, -8.25), [] {
@@ -294,6 +296,10 @@ extern "C" void load() {
     CustomCharacteristics::InstallHooks();
     LoadingFixHooks::InstallHooks();
 
-    CacheUtils::LoadFromFile();
+    // Audio and covers of zipped songs are extracted again once they're used, the old copies are deleted with the trash
+    ZipUtils::ClearExtractedFiles();
+    // Cache loading, enumeration, hashing and duration probing don't need the menu
+    Prescan::Start();
+    std::thread(SongLoader::EmptyTrash).detach();
     LOG_INFO("Successfully installed SongLoader!");
 }
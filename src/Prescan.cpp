@@ -0,0 +1,186 @@
+#include "Prescan.hpp"
+
+#include "API.hpp"
+#include "CustomLogger.hpp"
+#include "LoadScheduler.hpp"
+#include "Paths.hpp"
+
+#include "Utils/CacheUtils.hpp"
+#include "Utils/FileUtils.hpp"
+#include "Utils/HashUtils.hpp"
+#include "Utils/LevelInfoUtils.hpp"
+#include "Utils/OggVorbisUtils.hpp"
+#include "Utils/ZipUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace RuntimeSongLoader::Prescan {
+
+    // The game is loading its own assets meanwhile, so this leaves it some cores
+    #define PRESCAN_THREADS 4
+    // Folders whose info.dat and difficulty files are read in one batch
+    #define PRESCAN_BATCH_SIZE 16
+
+    std::mutex prescanMutex;
+    std::condition_variable finishedChanged;
+    bool started = false;
+    bool finished = false;
+    std::optional<std::vector<std::string>> folders;
+    std::optional<std::vector<SnapshotUtils::SnapshotLevel>> snapshot;
+
+    void ScanArchive(std::string const& songPath, CacheUtils::CacheData& cacheData) {
+        auto info = LevelInfoUtils::Read(songPath);
+        if(!info.has_value())
+            return;
+        if(!cacheData.sha1.has_value())
+            cacheData.sha1 = HashUtils::ComputeCustomLevelHash(songPath, info->GetDifficultyFiles());
+        if(!cacheData.songDuration.has_value() && !info->songFilename.empty()) {
+            float length = OggVorbisUtils::GetLengthFromLevelAudio(songPath, info->songFilename);
+            if(length > 0.0f && std::isfinite(length))
+                cacheData.songDuration = length;
+        }
+        CacheUtils::UpdateCacheData(songPath, cacheData);
+    }
+
+    struct ScannedFolder {
+        std::string const* path = nullptr;
+        CacheUtils::CacheData cacheData;
+        std::optional<LevelInfoUtils::LevelInfo> info;
+        std::size_t difficultiesEnd = 0;
+    };
+
+    // The files of a batch of folders are read together, so the reads of many levels are in flight at once
+    void ScanFolders(std::vector<std::string> const& songPaths, std::size_t first, std::size_t last) {
+        std::vector<ScannedFolder> scannedFolders;
+        std::vector<std::string> infoPaths;
+        for(std::size_t i = first; i < last; i++) {
+            // Fingerprints the folder and drops cached data that is outdated
+            auto cacheData = CacheUtils::GetCacheData(songPaths[i]);
+            if(!cacheData.has_value() || (cacheData->sha1.has_value() && cacheData->songDuration.has_value()))
+                continue;
+            // Zipped songs are read through their central directory instead of a batch
+            if(ZipUtils::IsArchivePath(songPaths[i])) {
+                ScanArchive(songPaths[i], *cacheData);
+                continue;
+            }
+            auto& folder = scannedFolders.emplace_back();
+            folder.path = &songPaths[i];
+            folder.cacheData = std::move(*cacheData);
+            infoPaths.push_back(LevelInfoUtils::GetInfoPath(songPaths[i]));
+        }
+        if(scannedFolders.empty())
+            return;
+        auto infoFiles = FileUtils::ReadFiles(infoPaths);
+        std::vector<std::string> difficultyPaths;
+        for(std::size_t i = 0; i < scannedFolders.size(); i++) {
+            auto& folder = scannedFolders[i];
+            if(!infoFiles[i].exists)
+                continue;
+            folder.info = LevelInfoUtils::Parse(infoFiles[i].data);
+            if(!folder.info.has_value() || folder.cacheData.sha1.has_value())
+                continue;
+            for(auto& file : folder.info->GetDifficultyFiles())
+                difficultyPaths.push_back(*folder.path + "/" + file);
+            folder.difficultiesEnd = difficultyPaths.size();
+        }
+        auto difficultyFiles = FileUtils::ReadFiles(difficultyPaths);
+        std::size_t difficultyIndex = 0;
+        for(std::size_t i = 0; i < scannedFolders.size(); i++) {
+            auto& folder = scannedFolders[i];
+            if(!folder.info.has_value())
+                continue;
+            if(!folder.cacheData.sha1.has_value()) {
+                std::vector<std::string_view> difficultyData;
+                for(; difficultyIndex < folder.difficultiesEnd; difficultyIndex++) {
+                    if(difficultyFiles[difficultyIndex].exists)
+                        difficultyData.push_back(difficultyFiles[difficultyIndex].data);
+                }
+                folder.cacheData.sha1 = HashUtils::HashLevelData(infoFiles[i].data, difficultyData);
+            }
+            if(!folder.cacheData.songDuration.has_value() && !folder.info->songFilename.empty()) {
+                float length = OggVorbisUtils::GetLengthFromOggVorbisFile(*folder.path + "/" + folder.info->songFilename);
+                // The refresh falls back to the difficulty files if the audio can't be probed
+                if(length > 0.0f && std::isfinite(length))
+                    folder.cacheData.songDuration = length;
+            }
+            CacheUtils::UpdateCacheData(*folder.path, folder.cacheData);
+        }
+        FileUtils::RecycleBuffers(infoFiles);
+        FileUtils::RecycleBuffers(difficultyFiles);
+    }
+
+    void Run() {
+        auto start = std::chrono::high_resolution_clock::now();
+        LoadScheduler::Scope scope(LoadPriority::Refresh);
+
+        CacheUtils::LoadFromFile();
+        auto snapshotLevels = SnapshotUtils::Load(GetBaseLevelsPath() + LibrarySnapshotFile);
+
+        std::vector<std::string> songFolders = FileUtils::GetFolders({ API::GetCustomLevelsPath(), API::GetCustomWIPLevelsPath() }, ZipUtils::ArchiveExtension);
+
+        std::atomic_size_t index = 0;
+        std::vector<std::thread> threads;
+        int threadsCount = std::min<int>(songFolders.size(), PRESCAN_THREADS);
+        for(int threadIndex = 0; threadIndex < threadsCount; threadIndex++) {
+            threads.emplace_back([&songFolders, &index] {
+                for(std::size_t first = index.fetch_add(PRESCAN_BATCH_SIZE); first < songFolders.size(); first = index.fetch_add(PRESCAN_BATCH_SIZE)) {
+                    LoadScheduler::Yield(LoadPriority::Refresh);
+                    ScanFolders(songFolders, first, std::min(songFolders.size(), first + PRESCAN_BATCH_SIZE));
+                }
+            });
+        }
+        for(auto& thread : threads)
+            thread.join();
+        FileUtils::ReleaseBufferPool();
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        LOG_INFO("Prescanned %d folders in %dms!", (int) songFolders.size(), (int) duration.count());
+        {
+            std::lock_guard<std::mutex> lock(prescanMutex);
+            folders = std::move(songFolders);
+            snapshot = std::move(snapshotLevels);
+            finished = true;
+        }
+        finishedChanged.notify_all();
+    }
+
+    void Start() {
+        {
+            std::lock_guard<std::mutex> lock(prescanMutex);
+            if(started)
+                return;
+            started = true;
+        }
+        std::thread(Run).detach();
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(prescanMutex);
+        if(!started)
+            return;
+        finishedChanged.wait(lock, [] { return finished; });
+    }
+
+    std::optional<std::vector<std::string>> TakeFolders() {
+        Wait();
+        std::lock_guard<std::mutex> lock(prescanMutex);
+        auto result = std::move(folders);
+        folders.reset();
+        return result;
+    }
+
+    std::optional<std::vector<SnapshotUtils::SnapshotLevel>> TakeSnapshot() {
+        Wait();
+        std::lock_guard<std::mutex> lock(prescanMutex);
+        auto result = std::move(snapshot);
+        snapshot.reset();
+        return result;
+    }
+
+}
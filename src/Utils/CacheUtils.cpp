@@ -23,8 +23,8 @@ namespace RuntimeSongLoader::CacheUtils {
     std::mutex cacheMapMutex;
 
     std::optional<CacheData> GetCacheData(std::string const& fullPath) {
-        auto directoryHash = HashUtils::GetDirectoryHash(fullPath);
-        if(!directoryHash.has_value())
+        auto directoryInfo = HashUtils::GetDirectoryInfo(fullPath);
+        if(!directoryInfo.has_value())
         {
             LOG_DEBUG("Hash for %s did not have value!", fullPath.c_str());
             return std::nullopt;
@@ -33,19 +33,33 @@ namespace RuntimeSongLoader::CacheUtils {
         auto search = cacheMap.find(fullPath);
         if(search != cacheMap.end()) {
             LOG_DEBUG("Found existing cache data for %s", fullPath.c_str());
-            auto data = search->second;
-            if(*directoryHash == data.directoryHash)
-                return search->second;
+            auto& data = search->second;
+            if(directoryInfo->hash == data.directoryHash) {
+                // Caches written before the time was kept get it from this listing
+                data.lastWriteTime = directoryInfo->lastWriteTime;
+                data.dataFilesSize = directoryInfo->dataFilesSize;
+                return data;
+            }
         }
         lock.unlock();
         CacheData data;
-        data.directoryHash = *directoryHash;
+        data.directoryHash = directoryInfo->hash;
         data.sha1 = std::nullopt;
         data.songDuration = std::nullopt;
+        data.lastWriteTime = directoryInfo->lastWriteTime;
+        data.dataFilesSize = directoryInfo->dataFilesSize;
         UpdateCacheData(fullPath, data);
         return data;
     }
 
+    std::optional<CacheData> PeekCacheData(std::string const& path) {
+        std::unique_lock<std::mutex> lock(cacheMapMutex);
+        auto search = cacheMap.find(path);
+        if(search == cacheMap.end())
+            return std::nullopt;
+        return search->second;
+    }
+
     void UpdateCacheData(std::string const& path, CacheData const& newData) {
         std::unique_lock<std::mutex> lock(cacheMapMutex);
         cacheMap[path] = newData;
@@ -91,6 +105,10 @@ namespace RuntimeSongLoader::CacheUtils {
                 if(data.songDuration.value() <= 0.0f)
                     data.songDuration = std::nullopt;
             }
+
+            auto lastWriteTimeIt = value.FindMember("lastWriteTime");
+            if(lastWriteTimeIt != value.MemberEnd() && lastWriteTimeIt->value.IsInt64())
+                data.lastWriteTime = lastWriteTimeIt->value.GetInt64();
             UpdateCacheData(it->name.GetString(), data);
         }
     }
@@ -117,6 +135,7 @@ namespace RuntimeSongLoader::CacheUtils {
                         value.AddMember("sha1", *data.sha1, allocator);
                     if(data.songDuration.has_value())
                         value.AddMember("songDuration", *data.songDuration, allocator);
+                    value.AddMember("lastWriteTime", data.lastWriteTime, allocator);
                     config.AddMember((ConfigValue::StringRefType)path.c_str(), value, allocator);
                 }
             }
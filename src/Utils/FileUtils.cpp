@@ -4,8 +4,23 @@
 
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <filesystem>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Big enough for a song folder or a few thousand song folders per getdents64 call
+#define DIRECTORY_BUFFER_SIZE (32 * 1024)
 
 namespace RuntimeSongLoader::FileUtils {
     
@@ -43,24 +58,120 @@ namespace RuntimeSongLoader::FileUtils {
         return data;
     }
 
-    std::vector<std::string> GetFolders(std::string_view path) {
+    // Layout the kernel writes, glibc and bionic don't declare it
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    std::optional<std::vector<DirectoryEntry>> ListDirectory(std::string_view path, bool statFiles) {
+        int directoryFd = open(std::string(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(directoryFd < 0)
+            return std::nullopt;
+        std::vector<DirectoryEntry> entries;
+        std::vector<char> buffer(DIRECTORY_BUFFER_SIZE);
+        while(true) {
+            long count = syscall(SYS_getdents64, directoryFd, buffer.data(), buffer.size());
+            if(count < 0) {
+                LOG_ERROR("Error reading directory at %s: %s", std::string(path).c_str(), strerror(errno));
+                break;
+            }
+            if(count == 0)
+                break;
+            for(long offset = 0; offset < count;) {
+                auto dirent = reinterpret_cast<LinuxDirent64*>(buffer.data() + offset);
+                offset += dirent->d_reclen;
+                std::string_view name = dirent->d_name;
+                if(name == "." || name == "..")
+                    continue;
+                auto& entry = entries.emplace_back();
+                entry.name = name;
+                entry.isDirectory = dirent->d_type == DT_DIR;
+                entry.isRegularFile = dirent->d_type == DT_REG;
+                // Some file systems (FUSE, sdcardfs) don't fill in the type, symlinks have to be followed
+                bool needsType = dirent->d_type == DT_UNKNOWN || dirent->d_type == DT_LNK;
+                if(!needsType && (entry.isDirectory || !statFiles))
+                    continue;
+                struct stat info;
+                if(fstatat(directoryFd, dirent->d_name, &info, 0) != 0)
+                    continue;
+                entry.isDirectory = S_ISDIR(info.st_mode);
+                entry.isRegularFile = S_ISREG(info.st_mode);
+                entry.size = info.st_size;
+                entry.lastWriteTime = info.st_mtim.tv_sec;
+            }
+        }
+        close(directoryFd);
+        return entries;
+    }
+
+    bool HasExtension(std::string_view name, std::string_view extension) {
+        if(extension.empty() || name.size() <= extension.size())
+            return false;
+        auto suffix = name.substr(name.size() - extension.size());
+        return std::equal(suffix.begin(), suffix.end(), extension.begin(), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+    }
+
+    std::vector<std::string> GetFolders(std::string_view path, std::string_view fileExtension) {
         std::vector<std::string> directories;
-        if(!std::filesystem::is_directory(path))
+        auto entries = ListDirectory(path);
+        if(!entries.has_value())
             return directories;
-        std::error_code ec;
-        auto directory_iterator = std::filesystem::directory_iterator(path, std::filesystem::directory_options::none, ec);
-        if (ec) {
-            LOG_ERROR("Error reading directory at %s: %s", path.data(), ec.message().c_str());
-        }
-        for (auto const& entry : directory_iterator) {
-            if(entry.is_directory())
-                directories.push_back(entry.path().string());
+        std::string prefix(path);
+        if(!prefix.ends_with('/'))
+            prefix += '/';
+        directories.reserve(entries->size());
+        for(auto& entry : *entries) {
+            if(entry.isDirectory || (entry.isRegularFile && HasExtension(entry.name, fileExtension)))
+                directories.push_back(prefix + entry.name);
         }
         return directories;
     }
 
-    void DeleteFolder(std::string_view path) {
-        std::filesystem::remove_all(path);
+    std::vector<std::string> GetFolders(std::vector<std::string> const& paths, std::string_view fileExtension) {
+        std::vector<std::vector<std::string>> folders(paths.size());
+        std::vector<std::thread> threads;
+        // The first path is listed on the calling thread
+        for(std::size_t i = 1; i < paths.size(); i++)
+            threads.emplace_back([&paths, &folders, fileExtension, i] { folders[i] = GetFolders(paths[i], fileExtension); });
+        if(!paths.empty())
+            folders[0] = GetFolders(paths[0], fileExtension);
+        for(auto& thread : threads)
+            thread.join();
+        std::vector<std::string> result;
+        for(auto& pathFolders : folders)
+            result.insert(result.end(), std::make_move_iterator(pathFolders.begin()), std::make_move_iterator(pathFolders.end()));
+        return result;
+    }
+
+    bool DeleteFolder(std::string_view path) {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+        if(ec) {
+            LOG_ERROR("Error deleting %s: %s", std::string(path).c_str(), ec.message().c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<std::string> MoveToTrash(std::string_view path, std::string_view trashPath) {
+        std::error_code ec;
+        std::filesystem::create_directories(trashPath, ec);
+        std::string_view trimmedPath = path;
+        while(trimmedPath.ends_with('/'))
+            trimmedPath.remove_suffix(1);
+        auto name = std::filesystem::path(trimmedPath).filename().string();
+        name += "_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        auto newPath = (std::filesystem::path(trashPath) / name).string();
+        std::filesystem::rename(trimmedPath, newPath, ec);
+        if(ec) {
+            LOG_ERROR("Error moving %s to trash: %s", std::string(path).c_str(), ec.message().c_str());
+            return std::nullopt;
+        }
+        return newPath;
     }
 
 }
\ No newline at end of file
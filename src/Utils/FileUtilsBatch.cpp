@@ -0,0 +1,370 @@
+#include "Utils/FileUtils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAS_IO_URING 1
+#else
+#define HAS_IO_URING 0
+#endif
+
+// Doesn't log or touch il2cpp, so bench/ can build it without the game's libraries
+namespace RuntimeSongLoader::FileUtils {
+
+    // Files open at once, also the size of the submission queue
+    #define READ_QUEUE_DEPTH 64
+    // Bytes of buffers kept for later ReadFiles, the rest gets freed
+    #define MAX_POOLED_BYTES (16 * 1024 * 1024)
+    // Larger buffers are freed right away, a few huge difficulties shouldn't take the whole pool
+    #define MAX_POOLED_BUFFER_SIZE (1024 * 1024)
+
+    std::mutex bufferPoolMutex;
+    std::vector<std::string> bufferPool;
+    std::size_t bufferPoolBytes = 0;
+
+    std::string TakeBuffer() {
+        std::lock_guard<std::mutex> lock(bufferPoolMutex);
+        if(bufferPool.empty())
+            return {};
+        auto buffer = std::move(bufferPool.back());
+        bufferPool.pop_back();
+        bufferPoolBytes -= buffer.capacity();
+        return buffer;
+    }
+
+    void RecycleBuffers(std::vector<ReadResult>& results) {
+        std::lock_guard<std::mutex> lock(bufferPoolMutex);
+        for(auto& result : results) {
+            std::size_t capacity = result.data.capacity();
+            if(capacity == 0 || capacity > MAX_POOLED_BUFFER_SIZE || bufferPoolBytes + capacity > MAX_POOLED_BYTES)
+                continue;
+            result.data.clear();
+            bufferPool.push_back(std::move(result.data));
+            bufferPoolBytes += capacity;
+        }
+    }
+
+    void ReleaseBufferPool() {
+        std::lock_guard<std::mutex> lock(bufferPoolMutex);
+        bufferPool.clear();
+        bufferPool.shrink_to_fit();
+        bufferPoolBytes = 0;
+    }
+
+    struct PendingRead {
+        ReadResult* result = nullptr;
+        int fd = -1;
+        std::size_t offset = 0;
+        bool done = false;
+        // Submitted to the ring and not completed yet
+        bool inFlight = false;
+        // Has to stay valid until the read completes
+        iovec buffer = {};
+    };
+
+    void ReadWithPread(PendingRead& read) {
+        auto& data = read.result->data;
+        while(read.offset < data.size()) {
+            ssize_t count = pread(read.fd, data.data() + read.offset, data.size() - read.offset, read.offset);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count < 0) {
+                read.result->exists = false;
+                data.clear();
+                break;
+            }
+            // The file got shorter since it was stat'ed
+            if(count == 0)
+                break;
+            read.offset += count;
+        }
+        if(read.result->exists)
+            data.resize(read.offset);
+        read.done = true;
+    }
+
+#if HAS_IO_URING
+    /// @brief Minimal io_uring on the raw syscalls, Android doesn't ship liburing
+    class IoUring {
+        private:
+            int fd = -1;
+            void* sqRing = MAP_FAILED;
+            std::size_t sqRingSize = 0;
+            void* cqRing = MAP_FAILED;
+            std::size_t cqRingSize = 0;
+            io_uring_sqe* sqes = reinterpret_cast<io_uring_sqe*>(MAP_FAILED);
+            std::size_t sqesSize = 0;
+            unsigned* sqHead = nullptr;
+            unsigned* sqTail = nullptr;
+            unsigned* sqMask = nullptr;
+            unsigned* sqArray = nullptr;
+            unsigned* cqHead = nullptr;
+            unsigned* cqTail = nullptr;
+            unsigned* cqMask = nullptr;
+            io_uring_cqe* cqes = nullptr;
+            unsigned queued = 0;
+
+        public:
+            ~IoUring() {
+                if(sqes != MAP_FAILED)
+                    munmap(sqes, sqesSize);
+                if(cqRing != MAP_FAILED && cqRing != sqRing)
+                    munmap(cqRing, cqRingSize);
+                if(sqRing != MAP_FAILED)
+                    munmap(sqRing, sqRingSize);
+                if(fd >= 0)
+                    close(fd);
+            }
+
+            /// @return False if the kernel doesn't support io_uring or the seccomp policy blocks it
+            bool Init(unsigned entries) {
+                io_uring_params params = {};
+                fd = syscall(__NR_io_uring_setup, entries, &params);
+                if(fd < 0)
+                    return false;
+                sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if(singleMmap)
+                    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+                sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+                if(sqRing == MAP_FAILED)
+                    return false;
+                cqRing = singleMmap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if(cqRing == MAP_FAILED)
+                    return false;
+                sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                sqes = reinterpret_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+                if(sqes == MAP_FAILED)
+                    return false;
+                auto sq = reinterpret_cast<char*>(sqRing);
+                auto cq = reinterpret_cast<char*>(cqRing);
+                sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                return true;
+            }
+
+            /// @brief Queues a read of the rest of the file, never more reads than entries may be in flight
+            void QueueRead(PendingRead& read, uint64_t userData) {
+                auto& data = read.result->data;
+                read.buffer.iov_base = data.data() + read.offset;
+                read.buffer.iov_len = data.size() - read.offset;
+                // Only this thread writes the tail
+                unsigned tail = *sqTail;
+                unsigned index = tail & *sqMask;
+                auto& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                // READV instead of READ works on kernels before 5.6 too
+                sqe.opcode = IORING_OP_READV;
+                sqe.fd = read.fd;
+                sqe.addr = reinterpret_cast<uint64_t>(&read.buffer);
+                sqe.len = 1;
+                sqe.off = read.offset;
+                sqe.user_data = userData;
+                sqArray[index] = index;
+                __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+                queued++;
+            }
+
+            /// @brief Submits the queued reads and waits until at least one read completed
+            bool SubmitAndWait() {
+                while(true) {
+                    int submitted = syscall(__NR_io_uring_enter, fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if(submitted < 0 && errno == EINTR)
+                        continue;
+                    if(submitted < 0)
+                        return false;
+                    queued -= submitted;
+                    return true;
+                }
+            }
+
+            /// @brief Waits until at least one submitted read completed, submits nothing
+            bool Wait() {
+                while(true) {
+                    int result = syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if(result < 0 && errno == EINTR)
+                        continue;
+                    return result >= 0;
+                }
+            }
+
+            /// @brief Takes back the queued reads the kernel didn't consume yet, calls dropped(userData) for every one
+            template<class F>
+            void DropQueued(F&& dropped) {
+                // Without SQPOLL the kernel only moves the head inside io_uring_enter
+                unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                unsigned tail = *sqTail;
+                for(unsigned i = head; i != tail; i++)
+                    dropped(sqes[sqArray[i & *sqMask]].user_data);
+                __atomic_store_n(sqTail, head, __ATOMIC_RELEASE);
+                queued = 0;
+            }
+
+            /// @brief Calls completed(userData, result) for every completed read
+            template<class F>
+            void ForEachCompletion(F&& completed) {
+                unsigned head = *cqHead;
+                unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                for(; head != tail; head++) {
+                    auto& cqe = cqes[head & *cqMask];
+                    completed(cqe.user_data, cqe.res);
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            }
+    };
+
+    bool ReadWithIoUring(IoUring& ring, std::vector<PendingRead>& reads) {
+        std::size_t inFlight = 0;
+        for(std::size_t i = 0; i < reads.size(); i++) {
+            if(reads[i].done)
+                continue;
+            ring.QueueRead(reads[i], i);
+            reads[i].inFlight = true;
+            inFlight++;
+        }
+        bool ringWorks = true;
+        auto completed = [&ring, &reads, &inFlight, &ringWorks](uint64_t index, int result) {
+            auto& read = reads[index];
+            read.inFlight = false;
+            inFlight--;
+            if(result > 0) {
+                read.offset += result;
+                if(read.offset < read.result->data.size()) {
+                    // After a failure the rest is read with pread
+                    if(ringWorks) {
+                        ring.QueueRead(read, index);
+                        read.inFlight = true;
+                        inFlight++;
+                    }
+                } else {
+                    read.done = true;
+                }
+            } else if(result == 0) {
+                read.result->data.resize(read.offset);
+                read.done = true;
+            }
+            // Failed reads are retried with pread below
+        };
+        while(inFlight > 0 && ringWorks) {
+            if(ring.SubmitAndWait()) {
+                ring.ForEachCompletion(completed);
+                continue;
+            }
+            ringWorks = false;
+            ring.DropQueued([&reads, &inFlight](uint64_t index) {
+                reads[index].inFlight = false;
+                inFlight--;
+            });
+        }
+        // The submitted reads still write into their buffers, pread can only take over once they completed
+        while(inFlight > 0 && ring.Wait())
+            ring.ForEachCompletion(completed);
+        for(auto& read : reads) {
+            if(read.inFlight) {
+                // The ring can't even wait anymore, the buffer is left to the kernel and the file read again into a new one
+                auto size = read.result->data.size();
+                new std::string(std::move(read.result->data));
+                read.result->data.assign(size, '\0');
+                read.offset = 0;
+                read.inFlight = false;
+            }
+            if(!read.done)
+                ReadWithPread(read);
+        }
+        return ringWorks;
+    }
+
+    // Setting up a ring costs more than it saves on a single batch, so every thread keeps its own
+    thread_local std::unique_ptr<IoUring> threadRing;
+    thread_local bool threadRingFailed = false;
+
+    /// @return nullptr if io_uring can't be used on this thread
+    IoUring* GetThreadRing() {
+        if(!threadRing && !threadRingFailed) {
+            threadRing = std::make_unique<IoUring>();
+            if(!threadRing->Init(READ_QUEUE_DEPTH)) {
+                threadRing.reset();
+                threadRingFailed = true;
+            }
+        }
+        return threadRing.get();
+    }
+#endif
+
+    bool IsIoUringAvailable() {
+#if HAS_IO_URING
+        static bool available = [] {
+            IoUring ring;
+            return ring.Init(2);
+        }();
+        return available;
+#else
+        return false;
+#endif
+    }
+
+    std::vector<ReadResult> ReadFiles(std::vector<std::string> const& paths, ReadBackend backend) {
+        std::vector<ReadResult> results(paths.size());
+#if HAS_IO_URING
+        IoUring* ring = backend != ReadBackend::Pread && IsIoUringAvailable() ? GetThreadRing() : nullptr;
+#endif
+        std::vector<PendingRead> reads;
+        reads.reserve(READ_QUEUE_DEPTH);
+        for(std::size_t first = 0; first < paths.size(); first += READ_QUEUE_DEPTH) {
+            reads.clear();
+            std::size_t last = std::min(paths.size(), first + READ_QUEUE_DEPTH);
+            for(std::size_t i = first; i < last; i++) {
+                int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+                if(fd < 0)
+                    continue;
+                struct stat info;
+                if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+                    close(fd);
+                    continue;
+                }
+                auto& result = results[i];
+                result.exists = true;
+                result.data = TakeBuffer();
+                result.data.resize(info.st_size);
+                auto& read = reads.emplace_back();
+                read.result = &result;
+                read.fd = fd;
+                read.done = info.st_size == 0;
+            }
+#if HAS_IO_URING
+            if(ring && !ReadWithIoUring(*ring, reads)) {
+                // The rest of this thread's reads use pread
+                threadRing.reset();
+                threadRingFailed = true;
+                ring = nullptr;
+            }
+#endif
+            for(auto& read : reads) {
+                if(!read.done)
+                    ReadWithPread(read);
+                close(read.fd);
+            }
+        }
+        return results;
+    }
+
+}
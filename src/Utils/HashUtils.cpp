@@ -2,27 +2,27 @@
 
 #include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
 
-#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+#include <sys/stat.h>
 
 #include "CustomLogger.hpp"
 
 #include "Utils/FileUtils.hpp"
 #include "Utils/CacheUtils.hpp"
+#include "Utils/LevelInfoUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 
 #include "libcryptopp/shared/sha.h"
 #include "libcryptopp/shared/hex.h"
 #include "libcryptopp/shared/files.h"
 
-#include "GlobalNamespace/StandardLevelInfoSaveData_DifficultyBeatmap.hpp"
-#include "GlobalNamespace/StandardLevelInfoSaveData_DifficultyBeatmapSet.hpp"
-#include "CustomTypes/CustomLevelInfoSaveData.hpp"
-
-using namespace GlobalNamespace;
 using namespace CryptoPP;
 
 namespace RuntimeSongLoader::HashUtils {
     
-    std::optional<std::string> GetCustomLevelHash(CustomJSONData::CustomLevelInfoSaveData* level, std::string const& customLevelPath) {
+    std::optional<std::string> GetCustomLevelHash(std::string const& customLevelPath, std::vector<std::string> const& difficultyFiles) {
         auto start = std::chrono::high_resolution_clock::now();
         std::string hashHex;
         LOG_DEBUG("GetCustomLevelHash Start");
@@ -39,9 +39,44 @@ namespace RuntimeSongLoader::HashUtils {
             return hashHex;
         }
 
-        std::string actualPath = customLevelPath + "/Info.dat";
-        if(!fileexists(actualPath)) 
-            actualPath = customLevelPath + "/info.dat";
+        auto computedHash = ComputeCustomLevelHash(customLevelPath, difficultyFiles);
+        if(!computedHash.has_value())
+            return std::nullopt;
+        hashHex = *computedHash;
+
+        cacheData.sha1 = hashHex;
+        CacheUtils::UpdateCacheData(customLevelPath, cacheData);
+
+        std::chrono::milliseconds duration = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start); 
+        LOG_DEBUG("GetCustomLevelHash Stop Result %s Time %d", hashHex.c_str(), (int)duration.count());
+        return hashHex;
+    }
+
+    std::optional<std::string> ComputeArchivedLevelHash(std::string const& customLevelPath, std::vector<std::string> const& difficultyFiles) {
+        // The members are inflated in memory, the zip is never extracted for hashing
+        auto infoText = LevelInfoUtils::ReadInfoText(customLevelPath);
+        if(infoText.empty())
+            return std::nullopt;
+        auto archive = ZipUtils::GetArchive(customLevelPath);
+        if(!archive)
+            return std::nullopt;
+        std::vector<std::string> difficultyTexts;
+        for(auto& diffFile : difficultyFiles) {
+            auto text = archive->Read(diffFile);
+            if(!text.has_value()) {
+                LOG_ERROR("GetCustomLevelHash File %s/%s did not exist", customLevelPath.c_str(), diffFile.c_str());
+                continue;
+            }
+            difficultyTexts.push_back(std::move(*text));
+        }
+        return HashLevelData(infoText, std::vector<std::string_view>(difficultyTexts.begin(), difficultyTexts.end()));
+    }
+
+    std::optional<std::string> ComputeCustomLevelHash(std::string const& customLevelPath, std::vector<std::string> const& difficultyFiles) {
+        if(ZipUtils::IsArchivePath(customLevelPath))
+            return ComputeArchivedLevelHash(customLevelPath, difficultyFiles);
+        // Same file the level is loaded from
+        std::string actualPath = LevelInfoUtils::GetInfoPath(customLevelPath);
         if(!fileexists(actualPath)) 
             return std::nullopt;
 
@@ -53,52 +88,74 @@ namespace RuntimeSongLoader::HashUtils {
         fs.Attach(new Redirector(hashFilter));
         fs.Pump(LWORD_MAX);
         fs.Detach();
-        for(auto val : level->difficultyBeatmapSets) {
-            if (!val) continue;
-            auto difficultyBeatmaps = val->difficultyBeatmaps;
-            if (!difficultyBeatmaps) continue;
-            for(auto difficultyBeatmap : difficultyBeatmaps) {
-                std::string diffFile = difficultyBeatmap->beatmapFilename;
-                std::string path(customLevelPath);
-                path.append("/").append(diffFile);
-                if(!fileexists(path)) {
-                    LOG_ERROR("GetCustomLevelHash File %s did not exist", path.c_str());
-                    continue;
-                } 
-                FileSource fs(path.c_str(), false);
-                fs.Attach(new Redirector(hashFilter));
-                fs.Pump(LWORD_MAX);
-                fs.Detach();
-            }
+        for(auto& diffFile : difficultyFiles) {
+            std::string path(customLevelPath);
+            path.append("/").append(diffFile);
+            if(!fileexists(path)) {
+                LOG_ERROR("GetCustomLevelHash File %s did not exist", path.c_str());
+                continue;
+            } 
+            FileSource fs(path.c_str(), false);
+            fs.Attach(new Redirector(hashFilter));
+            fs.Pump(LWORD_MAX);
+            fs.Detach();
         }
 
         hashFilter.MessageEnd();
         
+        std::string hashHex;
         HexEncoder hexEncoder(new StringSink(hashHex));
         hexEncoder.Put((const byte*)hashResult.data(), hashResult.size());
+        return hashHex;
+    }
 
-        cacheData.sha1 = hashHex;
-        CacheUtils::UpdateCacheData(customLevelPath, cacheData);
+    std::string HashLevelData(std::string_view infoData, std::vector<std::string_view> const& difficultyData) {
+        SHA1 hashType;
+        hashType.Update(reinterpret_cast<const byte*>(infoData.data()), infoData.size());
+        for(auto data : difficultyData)
+            hashType.Update(reinterpret_cast<const byte*>(data.data()), data.size());
+        std::string hashResult(hashType.DigestSize(), '\0');
+        hashType.Final(reinterpret_cast<byte*>(hashResult.data()));
 
-        std::chrono::milliseconds duration = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start); 
-        LOG_DEBUG("GetCustomLevelHash Stop Result %s Time %d", hashHex.c_str(), (int)duration.count());
+        std::string hashHex;
+        HexEncoder hexEncoder(new StringSink(hashHex));
+        hexEncoder.Put((const byte*)hashResult.data(), hashResult.size());
         return hashHex;
     }
 
-    std::optional<int> GetDirectoryHash(std::string_view path) {
-        if(!std::filesystem::is_directory(path))
+    std::optional<DirectoryInfo> GetDirectoryInfo(std::string_view path) {
+        if(ZipUtils::IsArchivePath(path)) {
+            struct stat info;
+            if(stat(std::string(path).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+                return std::nullopt;
+            // Same hash as ZipUtils::GetArchiveHash, a zip is only ever replaced as a whole
+            return DirectoryInfo{ static_cast<int>(info.st_size ^ info.st_mtim.tv_sec), info.st_mtim.tv_sec };
+        }
+        // Sizes and times come from one listing of the folder instead of a stat per query
+        auto entries = FileUtils::ListDirectory(path, true);
+        if(!entries.has_value())
             return std::nullopt;
-        int hash = 0;
+        DirectoryInfo directoryInfo;
         bool hasFile = false;
-        for (auto const& entry : std::filesystem::directory_iterator(path)) {
-            if(!entry.is_directory()) {
+        for(auto& entry : *entries) {
+            if(!entry.isDirectory) {
                 hasFile = true;
-                hash ^= entry.file_size() ^ std::chrono::duration_cast<std::chrono::seconds>(std::filesystem::last_write_time(entry).time_since_epoch()).count();
+                directoryInfo.hash ^= entry.size ^ entry.lastWriteTime;
+                directoryInfo.lastWriteTime = std::max(directoryInfo.lastWriteTime, entry.lastWriteTime);
+                if(entry.name.ends_with(".dat"))
+                    directoryInfo.dataFilesSize += entry.size;
             }
         }
         if(!hasFile)
             return std::nullopt;
-        return hash;
+        return directoryInfo;
+    }
+
+    std::optional<int> GetDirectoryHash(std::string_view path) {
+        auto directoryInfo = GetDirectoryInfo(path);
+        if(!directoryInfo.has_value())
+            return std::nullopt;
+        return directoryInfo->hash;
     }
     
 }
\ No newline at end of file
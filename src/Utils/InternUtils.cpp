@@ -0,0 +1,185 @@
+#include "Utils/InternUtils.hpp"
+
+#include "CustomLogger.hpp"
+
+#include "beatsaber-hook/shared/utils/il2cpp-utils.hpp"
+
+#include "GlobalNamespace/StandardLevelInfoSaveData_DifficultyBeatmap.hpp"
+#include "GlobalNamespace/StandardLevelInfoSaveData_DifficultyBeatmapSet.hpp"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace GlobalNamespace;
+using namespace System::Collections::Generic;
+
+namespace RuntimeSongLoader::InternUtils {
+
+    // Transparent so lookups can use the managed string without copying it
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::u16string_view text) const {
+            return std::hash<std::u16string_view>()(text);
+        }
+    };
+
+    // Weak GC handles, the levels keep the interned objects alive and the tables drop them once no level uses them anymore
+    std::unordered_map<std::u16string, uint32_t, StringHash, std::equal_to<>> strings;
+    std::unordered_map<std::string, uint32_t> previewSets;
+    std::unordered_map<std::string, uint32_t> previewSetLists;
+    std::mutex internMutex;
+    InternReport report;
+
+    std::size_t GetStringSize(std::u16string_view text) {
+        return sizeof(Il2CppString) + text.size() * sizeof(char16_t);
+    }
+
+    void AppendKey(std::string& key, PreviewDifficultyBeatmapSetInfo const& set) {
+        uint32_t count = set.beatmapDifficulties.size();
+        key.append(reinterpret_cast<const char*>(&set.beatmapCharacteristic), sizeof(set.beatmapCharacteristic));
+        key.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        key.append(reinterpret_cast<const char*>(set.beatmapDifficulties.data()), count * sizeof(BeatmapDifficulty));
+    }
+
+    uint32_t MakeWeakHandle(void* object) {
+        return il2cpp_functions::gchandle_new_weakref(reinterpret_cast<Il2CppObject*>(object), false);
+    }
+
+    // Finds the interned object of key, entries whose object got collected are removed
+    template<class TMap, class TKey>
+    Il2CppObject* FindAlive(TMap& map, TKey const& key) {
+        auto search = map.find(key);
+        if(search == map.end())
+            return nullptr;
+        if(auto target = il2cpp_functions::gchandle_get_target(search->second))
+            return target;
+        il2cpp_functions::gchandle_free(search->second);
+        map.erase(search);
+        return nullptr;
+    }
+
+    template<class TMap>
+    void RemoveCollected(TMap& map) {
+        std::erase_if(map, [](auto& entry) {
+            if(il2cpp_functions::gchandle_get_target(entry.second))
+                return false;
+            il2cpp_functions::gchandle_free(entry.second);
+            return true;
+        });
+    }
+
+    StringW InternStringUnsafe(StringW text) {
+        if(!text)
+            return text;
+        std::u16string_view view = text;
+        if(auto interned = reinterpret_cast<Il2CppString*>(FindAlive(strings, view))) {
+            if(interned != static_cast<Il2CppString*>(text)) {
+                report.sharedStrings++;
+                report.bytesSaved += GetStringSize(view);
+            }
+            return interned;
+        }
+        strings.emplace(view, MakeWeakHandle(static_cast<Il2CppString*>(text)));
+        report.internedStrings = strings.size();
+        return text;
+    }
+
+    StringW InternString(StringW text) {
+        std::lock_guard<std::mutex> lock(internMutex);
+        return InternStringUnsafe(text);
+    }
+
+    StringW InternString(std::string_view text) {
+        auto text16 = to_utf16(text);
+        std::lock_guard<std::mutex> lock(internMutex);
+        if(auto interned = reinterpret_cast<Il2CppString*>(FindAlive(strings, std::u16string_view(text16)))) {
+            report.sharedStrings++;
+            report.bytesSaved += GetStringSize(text16);
+            return interned;
+        }
+        return InternStringUnsafe(StringW(text16));
+    }
+
+    void InternStrings(StandardLevelInfoSaveData* standardLevelInfoSaveData) {
+        if(!standardLevelInfoSaveData)
+            return;
+        std::lock_guard<std::mutex> lock(internMutex);
+        standardLevelInfoSaveData->songAuthorName = InternStringUnsafe(standardLevelInfoSaveData->songAuthorName);
+        standardLevelInfoSaveData->levelAuthorName = InternStringUnsafe(standardLevelInfoSaveData->levelAuthorName);
+        standardLevelInfoSaveData->environmentName = InternStringUnsafe(standardLevelInfoSaveData->environmentName);
+        standardLevelInfoSaveData->allDirectionsEnvironmentName = InternStringUnsafe(standardLevelInfoSaveData->allDirectionsEnvironmentName);
+        if(!standardLevelInfoSaveData->difficultyBeatmapSets)
+            return;
+        for(auto difficultyBeatmapSet : standardLevelInfoSaveData->difficultyBeatmapSets) {
+            if(!difficultyBeatmapSet)
+                continue;
+            difficultyBeatmapSet->beatmapCharacteristicName = InternStringUnsafe(difficultyBeatmapSet->beatmapCharacteristicName);
+            if(!difficultyBeatmapSet->difficultyBeatmaps)
+                continue;
+            for(auto difficultyBeatmap : difficultyBeatmapSet->difficultyBeatmaps) {
+                if(difficultyBeatmap)
+                    difficultyBeatmap->difficulty = InternStringUnsafe(difficultyBeatmap->difficulty);
+            }
+        }
+    }
+
+    InternReport GetReport() {
+        std::lock_guard<std::mutex> lock(internMutex);
+        return report;
+    }
+
+    PreviewDifficultyBeatmapSet* GetPreviewDifficultyBeatmapSetUnsafe(PreviewDifficultyBeatmapSetInfo const& set) {
+        std::string key;
+        AppendKey(key, set);
+        if(auto interned = FindAlive(previewSets, key))
+            return reinterpret_cast<PreviewDifficultyBeatmapSet*>(interned);
+        auto array = ArrayW<BeatmapDifficulty>(set.beatmapDifficulties.size());
+        for(int i = 0; i < array.Length(); i++)
+            array[i] = set.beatmapDifficulties[i];
+        auto previewSet = PreviewDifficultyBeatmapSet::New_ctor(set.beatmapCharacteristic, array);
+        previewSets.emplace(std::move(key), MakeWeakHandle(previewSet));
+        return previewSet;
+    }
+
+    IReadOnlyList_1<PreviewDifficultyBeatmapSet*>* GetPreviewDifficultyBeatmapSets(std::vector<PreviewDifficultyBeatmapSetInfo> const& sets) {
+        std::string key;
+        for(auto& set : sets)
+            AppendKey(key, set);
+        std::lock_guard<std::mutex> lock(internMutex);
+        if(auto interned = FindAlive(previewSetLists, key)) {
+            report.sharedPreviewDifficultyBeatmapSetLists++;
+            // An array of the sets and one difficulty array per set
+            report.bytesSaved += sizeof(Il2CppArray) + sets.size() * (sizeof(Il2CppObject) + sizeof(void*));
+            for(auto& set : sets)
+                report.bytesSaved += sizeof(Il2CppArray) + set.beatmapDifficulties.size() * sizeof(BeatmapDifficulty);
+            return reinterpret_cast<IReadOnlyList_1<PreviewDifficultyBeatmapSet*>*>(interned);
+        }
+        // An array instead of a List, it is shared by many levels and can't be added to
+        auto array = ArrayW<PreviewDifficultyBeatmapSet*>(sets.size());
+        for(int i = 0; i < array.Length(); i++)
+            array[i] = GetPreviewDifficultyBeatmapSetUnsafe(sets[i]);
+        auto arrayObject = array.convert();
+        previewSetLists.emplace(std::move(key), MakeWeakHandle(arrayObject));
+        report.previewDifficultyBeatmapSetLists = previewSetLists.size();
+        LOG_DEBUG("InternUtils Created preview set list %d", (int) previewSetLists.size());
+        return reinterpret_cast<IReadOnlyList_1<PreviewDifficultyBeatmapSet*>*>(arrayObject);
+    }
+
+    void RemoveCollected() {
+        std::lock_guard<std::mutex> lock(internMutex);
+        RemoveCollected(strings);
+        RemoveCollected(previewSets);
+        RemoveCollected(previewSetLists);
+        report.internedStrings = strings.size();
+        report.previewDifficultyBeatmapSetLists = previewSetLists.size();
+    }
+
+    void ResetReport() {
+        std::lock_guard<std::mutex> lock(internMutex);
+        report = {};
+        report.internedStrings = strings.size();
+        report.previewDifficultyBeatmapSetLists = previewSetLists.size();
+    }
+
+}
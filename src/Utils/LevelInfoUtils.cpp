@@ -0,0 +1,103 @@
+#include "Utils/LevelInfoUtils.hpp"
+#include "Utils/FileUtils.hpp"
+#include "Utils/ZipUtils.hpp"
+
+#include "beatsaber-hook/shared/config/rapidjson-utils.hpp"
+#include "beatsaber-hook/shared/utils/utils.h"
+
+namespace RuntimeSongLoader::LevelInfoUtils {
+
+    std::string GetString(rapidjson::Value const& object, const char* name) {
+        auto member = object.FindMember(name);
+        if(member == object.MemberEnd() || !member->value.IsString())
+            return "";
+        return std::string(member->value.GetString(), member->value.GetStringLength());
+    }
+
+    float GetFloat(rapidjson::Value const& object, const char* name) {
+        auto member = object.FindMember(name);
+        if(member == object.MemberEnd() || !member->value.IsNumber())
+            return 0.0f;
+        return member->value.GetFloat();
+    }
+
+    std::vector<std::string> LevelInfo::GetDifficultyFiles() const {
+        std::vector<std::string> files;
+        for(auto& set : difficultyBeatmapSets) {
+            for(auto& filename : set.beatmapFilenames) {
+                if(!filename.empty())
+                    files.push_back(filename);
+            }
+        }
+        return files;
+    }
+
+    std::string GetInfoPath(std::string const& customLevelPath) {
+        std::string path = customLevelPath + "/info.dat";
+        if(!fileexists(path))
+            path = customLevelPath + "/Info.dat";
+        return path;
+    }
+
+    std::string ReadInfoText(std::string const& customLevelPath) {
+        if(!ZipUtils::IsArchivePath(customLevelPath))
+            return FileUtils::ReadAllText(GetInfoPath(customLevelPath));
+        // Same preference as GetInfoPath, the names are matched case sensitive first
+        auto archive = ZipUtils::GetArchive(customLevelPath);
+        if(!archive)
+            return "";
+        auto text = archive->Read(archive->Find("info.dat") ? "info.dat" : "Info.dat");
+        return text.has_value() ? std::move(*text) : "";
+    }
+
+    std::optional<LevelInfo> Parse(std::string_view json) {
+        // Some editors write a BOM, the game's parser skips it too
+        if(json.starts_with("\xEF\xBB\xBF"))
+            json.remove_prefix(3);
+        rapidjson::Document document;
+        document.Parse(json.data(), json.size());
+        if(document.HasParseError() || !document.IsObject())
+            return std::nullopt;
+        LevelInfo info;
+        info.songName = GetString(document, "_songName");
+        info.songSubName = GetString(document, "_songSubName");
+        info.songAuthorName = GetString(document, "_songAuthorName");
+        info.levelAuthorName = GetString(document, "_levelAuthorName");
+        info.beatsPerMinute = GetFloat(document, "_beatsPerMinute");
+        info.songTimeOffset = GetFloat(document, "_songTimeOffset");
+        info.shuffle = GetFloat(document, "_shuffle");
+        info.shufflePeriod = GetFloat(document, "_shufflePeriod");
+        info.previewStartTime = GetFloat(document, "_previewStartTime");
+        info.previewDuration = GetFloat(document, "_previewDuration");
+        info.songFilename = GetString(document, "_songFilename");
+        info.environmentName = GetString(document, "_environmentName");
+        info.allDirectionsEnvironmentName = GetString(document, "_allDirectionsEnvironmentName");
+        auto setsIt = document.FindMember("_difficultyBeatmapSets");
+        if(setsIt == document.MemberEnd() || !setsIt->value.IsArray())
+            return info;
+        for(auto& set : setsIt->value.GetArray()) {
+            if(!set.IsObject())
+                continue;
+            auto& setInfo = info.difficultyBeatmapSets.emplace_back();
+            setInfo.beatmapCharacteristicName = GetString(set, "_beatmapCharacteristicName");
+            auto difficultiesIt = set.FindMember("_difficultyBeatmaps");
+            if(difficultiesIt == set.MemberEnd() || !difficultiesIt->value.IsArray())
+                continue;
+            for(auto& difficulty : difficultiesIt->value.GetArray()) {
+                if(!difficulty.IsObject())
+                    continue;
+                setInfo.difficulties.push_back(GetString(difficulty, "_difficulty"));
+                setInfo.beatmapFilenames.push_back(GetString(difficulty, "_beatmapFilename"));
+            }
+        }
+        return info;
+    }
+
+    std::optional<LevelInfo> Read(std::string const& customLevelPath) {
+        auto text = ReadInfoText(customLevelPath);
+        if(text.empty())
+            return std::nullopt;
+        return Parse(text);
+    }
+
+}
@@ -3,26 +3,17 @@
 #include "CustomLogger.hpp"
 
 #include "Utils/FileUtils.hpp"
+#include "Utils/ZipUtils.hpp"
 
 namespace RuntimeSongLoader::OggVorbisUtils {
 
     const char VORBIS_BYTES[] = { 0x76, 0x6F, 0x72, 0x62, 0x69, 0x73 }; //"vorbis"
     const char OGG_BYTES[] = { 0x4F, 0x67, 0x67, 0x53, 0x00, 0x04 }; //"OggS" + 0x00 + 0x04
     #define OGG_OFFSET (8 + 2 + 4)
-    float GetLengthFromOggVorbisFile(std::string_view path) {
-        
-        auto start = std::chrono::high_resolution_clock::now();
-        LOG_DEBUG("GetLengthFromOggVorbisFile Start");
+    float GetLengthFromOggVorbisData(const char* dataStart, size_t dataLength) {
         float length = 0.0f;
-
-        size_t dataLength;
-        auto dataStart = FileUtils::ReadAllBytes(path, dataLength);
-        if(!dataStart)
-            return length;
-        if(dataLength <= 0) {
-            delete dataStart;
+        if(!dataStart || dataLength <= OGG_OFFSET + sizeof(VORBIS_BYTES))
             return length;
-        }
         long rate = 0;
         long long lastSample = 0;
 
@@ -42,13 +33,36 @@ namespace RuntimeSongLoader::OggVorbisUtils {
             }
         }
 
-        delete dataStart;
         if(rate != 0 & lastSample != 0)
             length = lastSample / (float)rate;
+        return length;
+    }
+
+    float GetLengthFromOggVorbisFile(std::string_view path) {
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        LOG_DEBUG("GetLengthFromOggVorbisFile Start");
+
+        size_t dataLength;
+        auto dataStart = FileUtils::ReadAllBytes(path, dataLength);
+        if(!dataStart)
+            return 0.0f;
+        float length = GetLengthFromOggVorbisData(dataStart, dataLength);
+        delete dataStart;
 
         std::chrono::milliseconds duration = duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start); 
         LOG_DEBUG("GetLengthFromOggVorbisFile Stop Result %f Time %d", length, (int)duration.count());
         return length;
     }
 
+    float GetLengthFromLevelAudio(std::string const& customLevelPath, std::string_view songFilename) {
+        if(!ZipUtils::IsArchivePath(customLevelPath))
+            return GetLengthFromOggVorbisFile(customLevelPath + "/" + std::string(songFilename));
+        // Only extracted once the song gets played
+        auto audio = ZipUtils::ReadLevelFile(customLevelPath, songFilename);
+        if(!audio.has_value())
+            return 0.0f;
+        return GetLengthFromOggVorbisData(audio->data(), audio->size());
+    }
+
 }
\ No newline at end of file
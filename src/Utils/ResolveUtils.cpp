@@ -0,0 +1,113 @@
+#include "Utils/ResolveUtils.hpp"
+#include "Utils/FindComponentsUtils.hpp"
+
+#include "CustomLogger.hpp"
+
+#include "beatsaber-hook/shared/utils/utils.h"
+
+#include "GlobalNamespace/BeatmapCharacteristicCollectionSO.hpp"
+#include "GlobalNamespace/EnvironmentsListSO.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace GlobalNamespace;
+
+namespace RuntimeSongLoader::ResolveUtils {
+
+    // Transparent so lookups can use the managed string without copying it
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::u16string_view text) const {
+            return std::hash<std::u16string_view>()(text);
+        }
+    };
+
+    template<class T>
+    using NameMap = std::unordered_map<std::u16string, T*, StringHash, std::equal_to<>>;
+
+    NameMap<BeatmapCharacteristicSO> characteristics;
+    NameMap<EnvironmentInfoSO> environments;
+    BeatmapCharacteristicSO* missingCharacteristic = nullptr;
+    bool isBuilt = false;
+    std::shared_mutex mapsMutex;
+
+    void BuildUnsafe() {
+        characteristics.clear();
+        environments.clear();
+        missingCharacteristic = nullptr;
+        isBuilt = true;
+        auto customLevelLoader = FindComponentsUtils::GetCustomLevelLoader();
+        if(!customLevelLoader)
+            return;
+        if(customLevelLoader->beatmapCharacteristicCollection) {
+            for(auto characteristic : customLevelLoader->beatmapCharacteristicCollection->beatmapCharacteristics) {
+                if(characteristic && characteristic->serializedName)
+                    characteristics.try_emplace(std::u16string(static_cast<std::u16string_view>(characteristic->serializedName)), characteristic);
+            }
+        }
+        if(customLevelLoader->environmentSceneInfoCollection) {
+            for(auto environment : customLevelLoader->environmentSceneInfoCollection->environmentInfos) {
+                if(environment && environment->serializedName)
+                    environments.try_emplace(std::u16string(static_cast<std::u16string_view>(environment->serializedName)), environment);
+            }
+        }
+        auto search = characteristics.find(u"MissingCharacteristic");
+        if(search != characteristics.end())
+            missingCharacteristic = search->second;
+        LOG_DEBUG("ResolveUtils Built maps with %d characteristics and %d environments", (int) characteristics.size(), (int) environments.size());
+    }
+
+    void EnsureBuilt() {
+        {
+            std::shared_lock<std::shared_mutex> lock(mapsMutex);
+            if(isBuilt)
+                return;
+        }
+        std::unique_lock<std::shared_mutex> lock(mapsMutex);
+        if(!isBuilt)
+            BuildUnsafe();
+    }
+
+    BeatmapCharacteristicSO* FindBeatmapCharacteristic(std::u16string_view serializedName) {
+        EnsureBuilt();
+        std::shared_lock<std::shared_mutex> lock(mapsMutex);
+        auto search = characteristics.find(serializedName);
+        if(search != characteristics.end())
+            return search->second;
+        return missingCharacteristic;
+    }
+
+    EnvironmentInfoSO* FindEnvironmentInfo(std::u16string_view serializedName) {
+        EnsureBuilt();
+        std::shared_lock<std::shared_mutex> lock(mapsMutex);
+        auto search = environments.find(serializedName);
+        if(search != environments.end())
+            return search->second;
+        return nullptr;
+    }
+
+    BeatmapCharacteristicSO* GetBeatmapCharacteristic(StringW serializedName) {
+        return FindBeatmapCharacteristic(serializedName ? static_cast<std::u16string_view>(serializedName) : u"");
+    }
+
+    BeatmapCharacteristicSO* GetBeatmapCharacteristic(std::string_view serializedName) {
+        return FindBeatmapCharacteristic(to_utf16(serializedName));
+    }
+
+    EnvironmentInfoSO* GetEnvironmentInfo(StringW serializedName) {
+        return FindEnvironmentInfo(serializedName ? static_cast<std::u16string_view>(serializedName) : u"");
+    }
+
+    EnvironmentInfoSO* GetEnvironmentInfo(std::string_view serializedName) {
+        return FindEnvironmentInfo(to_utf16(serializedName));
+    }
+
+    void Invalidate() {
+        std::unique_lock<std::shared_mutex> lock(mapsMutex);
+        isBuilt = false;
+    }
+
+}
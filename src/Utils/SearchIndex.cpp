@@ -0,0 +1,155 @@
+#include "Utils/SearchIndex.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace RuntimeSongLoader::SearchUtils {
+
+    // Bigrams are indexed too so two character queries don't scan every document, this bit keeps their keys apart
+    #define BIGRAM_KEY_FLAG (1ull << 48)
+
+    // Keys of the trigrams and bigrams of a text, or only those of the longest size if queryKeys
+    std::vector<uint64_t> GetKeys(std::u16string_view text, bool queryKeys) {
+        std::vector<uint64_t> keys;
+        if(text.size() < 2)
+            return keys;
+        keys.reserve(text.size() * 2);
+        for(std::size_t i = 0; i + 2 <= text.size(); i++) {
+            if(text[i] == FieldSeparator || text[i + 1] == FieldSeparator)
+                continue;
+            uint64_t bigram = ((uint64_t) text[i] << 16) | (uint64_t) text[i + 1];
+            if(!queryKeys || text.size() == 2)
+                keys.push_back(BIGRAM_KEY_FLAG | bigram);
+            if(i + 3 <= text.size() && text[i + 2] != FieldSeparator)
+                keys.push_back((bigram << 16) | (uint64_t) text[i + 2]);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    bool Matches(std::u16string_view text, std::u16string_view query, bool prefixOnly) {
+        auto position = text.find(query);
+        if(!prefixOnly)
+            return position != std::u16string_view::npos;
+        while(position != std::u16string_view::npos) {
+            if(position == 0 || text[position - 1] == FieldSeparator || text[position - 1] == u' ')
+                return true;
+            position = text.find(query, position + 1);
+        }
+        return false;
+    }
+
+    void SearchIndex::RemoveDocument(uint32_t id) {
+        auto& document = documents[id];
+        for(auto key : GetKeys(document.text, false)) {
+            auto search = postings.find(key);
+            if(search == postings.end())
+                continue;
+            auto& ids = search->second;
+            auto position = std::lower_bound(ids.begin(), ids.end(), id);
+            if(position != ids.end() && *position == id)
+                ids.erase(position);
+            if(ids.empty())
+                postings.erase(search);
+        }
+        documentIds.erase(document.key);
+        document.key = nullptr;
+        document.text.clear();
+        freeDocuments.push_back(id);
+    }
+
+    void SearchIndex::Add(const void* key, std::u16string text) {
+        auto existing = documentIds.find(key);
+        if(existing != documentIds.end())
+            RemoveDocument(existing->second);
+        uint32_t id;
+        if(!freeDocuments.empty()) {
+            id = freeDocuments.back();
+            freeDocuments.pop_back();
+        } else {
+            id = documents.size();
+            documents.emplace_back();
+        }
+        for(auto key : GetKeys(text, false)) {
+            auto& ids = postings[key];
+            ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+        }
+        documents[id].key = key;
+        documents[id].text = std::move(text);
+        documentIds.emplace(key, id);
+    }
+
+    void SearchIndex::Remove(const void* key) {
+        auto search = documentIds.find(key);
+        if(search != documentIds.end())
+            RemoveDocument(search->second);
+    }
+
+    void SearchIndex::RemoveExcept(std::unordered_set<const void*> const& keys) {
+        std::vector<uint32_t> removed;
+        for(auto& [key, id] : documentIds) {
+            if(!keys.contains(key))
+                removed.push_back(id);
+        }
+        for(auto id : removed)
+            RemoveDocument(id);
+    }
+
+    bool SearchIndex::Contains(const void* key) const {
+        return documentIds.contains(key);
+    }
+
+    void SearchIndex::Clear() {
+        documents.clear();
+        freeDocuments.clear();
+        documentIds.clear();
+        postings.clear();
+    }
+
+    std::size_t SearchIndex::GetDocumentsCount() const {
+        return documentIds.size();
+    }
+
+    std::size_t SearchIndex::GetKeysCount() const {
+        return postings.size();
+    }
+
+    std::vector<const void*> SearchIndex::Search(std::u16string_view foldedQuery, bool prefixOnly) const {
+        std::vector<const void*> results;
+        if(foldedQuery.empty())
+            return results;
+        auto keys = GetKeys(foldedQuery, true);
+        if(keys.empty()) {
+            // Single characters, the native texts are small enough to scan
+            for(auto& document : documents) {
+                if(document.key && Matches(document.text, foldedQuery, prefixOnly))
+                    results.push_back(document.key);
+            }
+            return results;
+        }
+        std::vector<std::vector<uint32_t> const*> postingLists;
+        postingLists.reserve(keys.size());
+        for(auto key : keys) {
+            auto search = postings.find(key);
+            if(search == postings.end())
+                return results;
+            postingLists.push_back(&search->second);
+        }
+        std::sort(postingLists.begin(), postingLists.end(), [](auto first, auto second) { return first->size() < second->size(); });
+        std::vector<uint32_t> candidates = *postingLists.front();
+        std::vector<uint32_t> intersection;
+        for(std::size_t i = 1; i < postingLists.size() && !candidates.empty(); i++) {
+            intersection.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), postingLists[i]->begin(), postingLists[i]->end(), std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+        for(auto id : candidates) {
+            auto& document = documents[id];
+            if(Matches(document.text, foldedQuery, prefixOnly))
+                results.push_back(document.key);
+        }
+        return results;
+    }
+
+}
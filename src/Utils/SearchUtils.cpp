@@ -0,0 +1,77 @@
+#include "Utils/SearchUtils.hpp"
+#include "Utils/SearchIndex.hpp"
+#include "Utils/StringUtils.hpp"
+
+#include "CustomLogger.hpp"
+
+#include "beatsaber-hook/shared/utils/utils.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+
+using namespace GlobalNamespace;
+
+namespace RuntimeSongLoader::SearchUtils {
+
+    SearchIndex index;
+    std::shared_mutex indexMutex;
+
+    std::u16string GetDocumentText(CustomPreviewBeatmapLevel* level) {
+        std::u16string text;
+        bool first = true;
+        for(StringW field : { level->songName, level->songSubName, level->songAuthorName, level->levelAuthorName }) {
+            if(!first)
+                text += FieldSeparator;
+            first = false;
+            if(field)
+                text += StringUtils::FoldCase(field);
+        }
+        return text;
+    }
+
+    void AddLevel(CustomPreviewBeatmapLevel* level) {
+        if(!level)
+            return;
+        auto text = GetDocumentText(level);
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        index.Add(level, std::move(text));
+    }
+
+    void RemoveLevel(CustomPreviewBeatmapLevel* level) {
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        index.Remove(level);
+    }
+
+    void SetLevels(std::vector<CustomPreviewBeatmapLevel*> const& levels) {
+        std::unordered_set<const void*> wanted(levels.begin(), levels.end());
+        std::vector<std::pair<CustomPreviewBeatmapLevel*, std::u16string>> added;
+        {
+            std::shared_lock<std::shared_mutex> lock(indexMutex);
+            for(auto level : levels) {
+                if(level && !index.Contains(level))
+                    added.emplace_back(level, GetDocumentText(level));
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        index.RemoveExcept(wanted);
+        for(auto& [level, text] : added)
+            index.Add(level, std::move(text));
+        LOG_DEBUG("SearchUtils Indexed %d levels with %d keys", (int) index.GetDocumentsCount(), (int) index.GetKeysCount());
+    }
+
+    void Clear() {
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        index.Clear();
+    }
+
+    std::vector<CustomPreviewBeatmapLevel*> Search(std::string_view query, bool prefixOnly) {
+        std::vector<CustomPreviewBeatmapLevel*> results;
+        auto foldedQuery = StringUtils::FoldCase(to_utf16(query));
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        for(auto key : index.Search(foldedQuery, prefixOnly))
+            results.push_back(static_cast<CustomPreviewBeatmapLevel*>(const_cast<void*>(key)));
+        return results;
+    }
+
+}
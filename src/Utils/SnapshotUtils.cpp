@@ -0,0 +1,146 @@
+#include "Utils/SnapshotUtils.hpp"
+#include "Utils/LevelInfoUtils.hpp"
+
+#include "CustomLogger.hpp"
+#include "LoadScheduler.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace RuntimeSongLoader::SnapshotUtils {
+
+    // Bump when the layout changes, older snapshots are ignored then
+    #define SNAPSHOT_MAGIC 0x4E534C53 // SLSN
+    #define SNAPSHOT_VERSION 1
+
+    class Reader {
+        private:
+            std::string_view data;
+            std::size_t position = 0;
+            bool failed = false;
+
+        public:
+            explicit Reader(std::string_view data) : data(data) {}
+
+            template<class T>
+            T Read() {
+                T value{};
+                if(failed || data.size() - position < sizeof(T)) {
+                    failed = true;
+                    return value;
+                }
+                std::memcpy(&value, data.data() + position, sizeof(T));
+                position += sizeof(T);
+                return value;
+            }
+
+            std::string ReadString() {
+                auto size = Read<uint32_t>();
+                if(failed || data.size() - position < size) {
+                    failed = true;
+                    return "";
+                }
+                std::string value(data.substr(position, size));
+                position += size;
+                return value;
+            }
+
+            bool Failed() const {
+                return failed;
+            }
+    };
+
+    template<class T>
+    void Write(std::string& data, T value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(std::string& data, std::string_view value) {
+        Write<uint32_t>(data, value.size());
+        data.append(value);
+    }
+
+    std::vector<SnapshotLevel> Load(std::string_view path) {
+        std::vector<SnapshotLevel> levels;
+        std::ifstream fileStream(std::string(path), std::ios::binary);
+        if(!fileStream.is_open())
+            return levels;
+        std::string data((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+        Reader reader(data);
+        if(reader.Read<uint32_t>() != SNAPSHOT_MAGIC || reader.Read<uint32_t>() != SNAPSHOT_VERSION) {
+            LOG_INFO("SnapshotUtils Ignoring outdated snapshot %s", std::string(path).c_str());
+            return levels;
+        }
+        auto count = reader.Read<uint32_t>();
+        levels.reserve(std::min<uint32_t>(count, data.size() / 16));
+        for(uint32_t i = 0; i < count && !reader.Failed(); i++) {
+            SnapshotLevel& level = levels.emplace_back();
+            level.path = reader.ReadString();
+            level.wip = reader.Read<uint8_t>() != 0;
+            level.hash = reader.ReadString();
+            level.directoryHash = reader.Read<int32_t>();
+            level.songDuration = reader.Read<float>();
+            level.infoText = reader.ReadString();
+        }
+        if(reader.Failed()) {
+            LOG_ERROR("SnapshotUtils Snapshot %s is corrupted!", std::string(path).c_str());
+            levels.clear();
+        }
+        return levels;
+    }
+
+    bool Save(std::string_view path, std::vector<SnapshotLevel> levels) {
+        // Workers of two refreshes would read the previous snapshot and write the same temporary file at once
+        static std::mutex saveMutex;
+        std::lock_guard<std::mutex> lock(saveMutex);
+        LoadScheduler::Scope scope(LoadPriority::Background);
+        // Unchanged folders keep their info.dat from the previous snapshot instead of reading it again
+        std::unordered_map<std::string, SnapshotLevel> previousLevels;
+        for(auto& level : Load(path)) {
+            auto levelPath = level.path;
+            previousLevels.emplace(std::move(levelPath), std::move(level));
+        }
+        std::string data;
+        Write<uint32_t>(data, SNAPSHOT_MAGIC);
+        Write<uint32_t>(data, SNAPSHOT_VERSION);
+        Write<uint32_t>(data, levels.size());
+        for(auto& level : levels) {
+            if(level.infoText.empty()) {
+                auto search = previousLevels.find(level.path);
+                if(search != previousLevels.end() && search->second.directoryHash == level.directoryHash) {
+                    level.infoText = std::move(search->second.infoText);
+                } else {
+                    LoadScheduler::Yield(LoadPriority::Background);
+                    level.infoText = LevelInfoUtils::ReadInfoText(level.path);
+                }
+            }
+            WriteString(data, level.path);
+            Write<uint8_t>(data, level.wip ? 1 : 0);
+            WriteString(data, level.hash);
+            Write<int32_t>(data, level.directoryHash);
+            Write<float>(data, level.songDuration);
+            WriteString(data, level.infoText);
+        }
+        // Written next to the snapshot and renamed, so a crash never leaves a half written one behind
+        std::string temporaryPath = std::string(path) + ".tmp";
+        {
+            std::ofstream fileStream(temporaryPath, std::ios::binary | std::ios::trunc);
+            if(!fileStream.is_open() || !fileStream.write(data.data(), data.size())) {
+                LOG_ERROR("SnapshotUtils Can't write %s!", temporaryPath.c_str());
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if(error) {
+            LOG_ERROR("SnapshotUtils Can't write %s: %s!", std::string(path).c_str(), error.message().c_str());
+            return false;
+        }
+        LOG_INFO("SnapshotUtils Saved %d levels, %dKB", (int) levels.size(), (int) (data.size() / 1024));
+        return true;
+    }
+
+}
@@ -0,0 +1,20 @@
+#include "Utils/StringUtils.hpp"
+
+#include <cwctype>
+
+namespace RuntimeSongLoader::StringUtils {
+
+    std::u16string FoldCase(std::u16string_view text) {
+        std::u16string folded(text);
+        for(auto& character : folded) {
+            if(character < 0x80) {
+                if(character >= u'A' && character <= u'Z')
+                    character += u'a' - u'A';
+            } else {
+                character = static_cast<char16_t>(std::towlower(character));
+            }
+        }
+        return folded;
+    }
+
+}
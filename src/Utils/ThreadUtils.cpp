@@ -0,0 +1,72 @@
+#include "Utils/ThreadUtils.hpp"
+
+#include "CustomLogger.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace RuntimeSongLoader::ThreadUtils {
+
+    std::optional<cpu_set_t> GetEfficiencyCores() {
+        int coresCount = sysconf(_SC_NPROCESSORS_CONF);
+        std::vector<uint64_t> maxFrequencies;
+        for(int core = 0; core < coresCount && core < CPU_SETSIZE; core++) {
+            uint64_t frequency = 0;
+            std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(core) + "/cpufreq/cpuinfo_max_freq");
+            if(!(file >> frequency))
+                return std::nullopt;
+            maxFrequencies.push_back(frequency);
+        }
+        if(maxFrequencies.empty())
+            return std::nullopt;
+        auto [minFrequency, maxFrequency] = std::minmax_element(maxFrequencies.begin(), maxFrequencies.end());
+        if(*minFrequency == *maxFrequency)
+            return std::nullopt;
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        for(int core = 0; core < maxFrequencies.size(); core++) {
+            if(maxFrequencies[core] == *minFrequency)
+                CPU_SET(core, &cores);
+        }
+        return cores;
+    }
+
+    void LowerCurrentThreadPriority(int niceness, bool efficiencyCoresOnly) {
+        pid_t threadId = gettid();
+        if(setpriority(PRIO_PROCESS, threadId, niceness) != 0)
+            LOG_WARN("ThreadUtils Can't set niceness %d: %d", niceness, errno);
+        if(!efficiencyCoresOnly)
+            return;
+        // The cores don't change, so they are only read once
+        static std::optional<cpu_set_t> efficiencyCores = GetEfficiencyCores();
+        if(efficiencyCores.has_value() && sched_setaffinity(threadId, sizeof(cpu_set_t), &*efficiencyCores) != 0)
+            LOG_WARN("ThreadUtils Can't pin thread to efficiency cores: %d", errno);
+    }
+
+    Throttle::Throttle(float cpuShare, uint64_t maxBytesPerSecond) : cpuShare(cpuShare), maxBytesPerSecond(maxBytesPerSecond) {}
+
+    void Throttle::Pace(std::chrono::steady_clock::duration workTime, uint64_t bytes) {
+        auto sleepTime = std::chrono::steady_clock::duration::zero();
+        // Idle long enough that the work only made up cpuShare of the time
+        if(cpuShare > 0.0f && cpuShare < 1.0f)
+            sleepTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(workTime * ((1.0f - cpuShare) / cpuShare));
+        if(maxBytesPerSecond > 0 && bytes > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto now = std::chrono::steady_clock::now();
+            auto readTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((double) bytes / maxBytesPerSecond));
+            nextBytesAvailable = std::max(nextBytesAvailable, now) + readTime;
+            sleepTime = std::max(sleepTime, nextBytesAvailable - now);
+        }
+        if(sleepTime > std::chrono::steady_clock::duration::zero())
+            std::this_thread::sleep_for(sleepTime);
+    }
+
+}
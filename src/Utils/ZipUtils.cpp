@@ -0,0 +1,480 @@
+#include "Utils/ZipUtils.hpp"
+#include "Utils/FileUtils.hpp"
+
+#include "CustomLogger.hpp"
+#include "Paths.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+namespace RuntimeSongLoader::ZipUtils {
+
+    #define END_OF_CENTRAL_DIRECTORY_SIGNATURE 0x06054b50
+    #define END_OF_CENTRAL_DIRECTORY_SIZE 22
+    #define CENTRAL_DIRECTORY_HEADER_SIGNATURE 0x02014b50
+    #define CENTRAL_DIRECTORY_HEADER_SIZE 46
+    #define LOCAL_FILE_HEADER_SIGNATURE 0x04034b50
+    #define LOCAL_FILE_HEADER_SIZE 30
+    #define MAX_COMMENT_SIZE 0xFFFF
+    // Compressed data is read and inflated in chunks of this size
+    #define INFLATE_CHUNK_SIZE (64 * 1024)
+    // Archives whose central directory is kept for later reads
+    #define MAX_CACHED_ARCHIVES 64
+
+    #define METHOD_STORED 0
+    #define METHOD_DEFLATED 8
+    #define FLAG_ENCRYPTED 0x1
+
+    uint16_t ReadUInt16(const char* data) {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        return bytes[0] | (bytes[1] << 8);
+    }
+
+    uint32_t ReadUInt32(const char* data) {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    bool ReadAt(int fd, char* buffer, std::size_t size, uint64_t offset) {
+        while(size > 0) {
+            ssize_t count = pread(fd, buffer, size, offset);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count <= 0)
+                return false;
+            buffer += count;
+            size -= count;
+            offset += count;
+        }
+        return true;
+    }
+
+    bool EqualsIgnoreCase(std::string_view first, std::string_view second) {
+        return first.size() == second.size() && std::equal(first.begin(), first.end(), second.begin(), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+    }
+
+    bool IsArchivePath(std::string_view path) {
+        while(path.ends_with('/'))
+            path.remove_suffix(1);
+        if(path.size() <= ArchiveExtension.size() || !EqualsIgnoreCase(path.substr(path.size() - ArchiveExtension.size()), ArchiveExtension))
+            return false;
+        // Song folders can be named like zips too
+        struct stat info;
+        return stat(std::string(path).c_str(), &info) == 0 && S_ISREG(info.st_mode);
+    }
+
+    bool IsInfoName(std::string_view name) {
+        auto slash = name.rfind('/');
+        auto fileName = slash == std::string_view::npos ? name : name.substr(slash + 1);
+        return fileName == "info.dat" || fileName == "Info.dat";
+    }
+
+    // Names come from the archive or the info.dat, neither may point outside the extraction folder
+    bool IsSafeMemberName(std::string_view name) {
+        if(name.empty() || name.starts_with('/') || name.find('\0') != std::string_view::npos)
+            return false;
+        while(!name.empty()) {
+            auto slash = name.find('/');
+            auto component = name.substr(0, slash);
+            if(component == "..")
+                return false;
+            if(slash == std::string_view::npos)
+                break;
+            name.remove_prefix(slash + 1);
+        }
+        return true;
+    }
+
+    std::shared_ptr<ZipArchive> ZipArchive::Open(std::string const& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return nullptr;
+        struct stat info;
+        if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size < END_OF_CENTRAL_DIRECTORY_SIZE) {
+            close(fd);
+            return nullptr;
+        }
+        uint64_t fileSize = info.st_size;
+        // The end record is at the end of the file, only followed by the archive comment
+        std::size_t tailSize = std::min<uint64_t>(fileSize, END_OF_CENTRAL_DIRECTORY_SIZE + MAX_COMMENT_SIZE);
+        std::string tail(tailSize, '\0');
+        if(!ReadAt(fd, tail.data(), tailSize, fileSize - tailSize)) {
+            close(fd);
+            return nullptr;
+        }
+        const char* endRecord = nullptr;
+        for(std::size_t i = tailSize - END_OF_CENTRAL_DIRECTORY_SIZE + 1; i-- > 0;) {
+            if(ReadUInt32(tail.data() + i) == END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+                endRecord = tail.data() + i;
+                break;
+            }
+        }
+        if(!endRecord) {
+            LOG_ERROR("ZipArchive %s isn't a zip!", path.c_str());
+            close(fd);
+            return nullptr;
+        }
+        uint16_t entriesCount = ReadUInt16(endRecord + 10);
+        uint32_t centralDirectorySize = ReadUInt32(endRecord + 12);
+        uint32_t centralDirectoryOffset = ReadUInt32(endRecord + 16);
+        // Songs are far too small to need ZIP64
+        if(entriesCount == 0xFFFF || centralDirectorySize == 0xFFFFFFFF || centralDirectoryOffset == 0xFFFFFFFF || static_cast<uint64_t>(centralDirectoryOffset) + centralDirectorySize > fileSize) {
+            LOG_ERROR("ZipArchive %s is a ZIP64 or broken zip!", path.c_str());
+            close(fd);
+            return nullptr;
+        }
+        std::string centralDirectory(centralDirectorySize, '\0');
+        bool read = ReadAt(fd, centralDirectory.data(), centralDirectorySize, centralDirectoryOffset);
+        close(fd);
+        if(!read)
+            return nullptr;
+
+        auto archive = std::make_shared<ZipArchive>();
+        archive->path = path;
+        archive->fileSize = fileSize;
+        archive->lastWriteTime = info.st_mtim.tv_sec;
+        archive->entries.reserve(entriesCount);
+        std::size_t offset = 0;
+        for(int i = 0; i < entriesCount; i++) {
+            if(offset + CENTRAL_DIRECTORY_HEADER_SIZE > centralDirectory.size())
+                break;
+            const char* header = centralDirectory.data() + offset;
+            if(ReadUInt32(header) != CENTRAL_DIRECTORY_HEADER_SIGNATURE)
+                break;
+            uint16_t flags = ReadUInt16(header + 8);
+            uint16_t nameLength = ReadUInt16(header + 28);
+            uint16_t extraLength = ReadUInt16(header + 30);
+            uint16_t commentLength = ReadUInt16(header + 32);
+            if(offset + CENTRAL_DIRECTORY_HEADER_SIZE + nameLength > centralDirectory.size())
+                break;
+            offset += CENTRAL_DIRECTORY_HEADER_SIZE + nameLength + extraLength + commentLength;
+            std::string name(header + CENTRAL_DIRECTORY_HEADER_SIZE, nameLength);
+            // Zips made on Windows sometimes use backslashes
+            std::replace(name.begin(), name.end(), '\\', '/');
+            if(name.empty() || name.ends_with('/') || (flags & FLAG_ENCRYPTED))
+                continue;
+            if(!IsSafeMemberName(name)) {
+                LOG_WARN("ZipArchive %s skipped the member %s, it points outside the archive!", path.c_str(), name.c_str());
+                continue;
+            }
+            auto& entry = archive->entries.emplace_back();
+            entry.name = std::move(name);
+            entry.method = ReadUInt16(header + 10);
+            entry.crc32 = ReadUInt32(header + 16);
+            entry.compressedSize = ReadUInt32(header + 20);
+            entry.size = ReadUInt32(header + 24);
+            entry.localHeaderOffset = ReadUInt32(header + 42);
+        }
+
+        // Names are made relative to the shallowest info.dat, so zips of the song folder work too
+        std::string_view root;
+        bool foundInfo = false;
+        for(auto& entry : archive->entries) {
+            if(!IsInfoName(entry.name))
+                continue;
+            std::string_view name = entry.name;
+            auto folder = name.substr(0, name.rfind('/') + 1);
+            if(!foundInfo || folder.size() < root.size())
+                root = folder;
+            foundInfo = true;
+        }
+        if(!root.empty()) {
+            std::string prefix(root);
+            std::erase_if(archive->entries, [&prefix](auto& entry) { return !entry.name.starts_with(prefix); });
+            for(auto& entry : archive->entries)
+                entry.name.erase(0, prefix.size());
+        }
+        return archive;
+    }
+
+    ZipEntry const* ZipArchive::Find(std::string_view name) const {
+        for(auto& entry : entries) {
+            if(entry.name == name)
+                return &entry;
+        }
+        for(auto& entry : entries) {
+            if(EqualsIgnoreCase(entry.name, name))
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    bool ZipArchive::Inflate(ZipEntry const& entry, std::function<bool(const char*, std::size_t)> const& output) const {
+        if(entry.method != METHOD_STORED && entry.method != METHOD_DEFLATED) {
+            LOG_ERROR("ZipArchive %s uses the unsupported compression %d!", entry.name.c_str(), (int) entry.method);
+            return false;
+        }
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return false;
+        char localHeader[LOCAL_FILE_HEADER_SIZE];
+        if(!ReadAt(fd, localHeader, LOCAL_FILE_HEADER_SIZE, entry.localHeaderOffset) || ReadUInt32(localHeader) != LOCAL_FILE_HEADER_SIGNATURE) {
+            LOG_ERROR("ZipArchive %s has a broken local header!", entry.name.c_str());
+            close(fd);
+            return false;
+        }
+        // The local header's name and extra field may differ from the central directory's
+        uint64_t dataOffset = static_cast<uint64_t>(entry.localHeaderOffset) + LOCAL_FILE_HEADER_SIZE + ReadUInt16(localHeader + 26) + ReadUInt16(localHeader + 28);
+        if(dataOffset + entry.compressedSize > fileSize) {
+            close(fd);
+            return false;
+        }
+
+        std::vector<char> input(INFLATE_CHUNK_SIZE);
+        std::vector<char> inflated(entry.method == METHOD_DEFLATED ? INFLATE_CHUNK_SIZE : 0);
+        z_stream stream = {};
+        // Raw deflate, zip members have no zlib header
+        if(entry.method == METHOD_DEFLATED && inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            close(fd);
+            return false;
+        }
+        uLong crc = crc32(0, Z_NULL, 0);
+        uint64_t remaining = entry.compressedSize;
+        uint64_t written = 0;
+        bool success = true;
+        bool finished = false;
+        while(success && !finished) {
+            std::size_t chunkSize = std::min<uint64_t>(remaining, input.size());
+            if(chunkSize > 0 && !ReadAt(fd, input.data(), chunkSize, dataOffset + entry.compressedSize - remaining)) {
+                success = false;
+                break;
+            }
+            remaining -= chunkSize;
+            if(entry.method == METHOD_STORED) {
+                written += chunkSize;
+                crc = crc32(crc, reinterpret_cast<const Bytef*>(input.data()), chunkSize);
+                success = written <= entry.size && (chunkSize == 0 || output(input.data(), chunkSize));
+                finished = remaining == 0;
+                continue;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = chunkSize;
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(inflated.data());
+                stream.avail_out = inflated.size();
+                int result = inflate(&stream, Z_NO_FLUSH);
+                // No progress possible, needs the next chunk
+                if(result == Z_BUF_ERROR)
+                    break;
+                if(result != Z_OK && result != Z_STREAM_END) {
+                    success = false;
+                    break;
+                }
+                std::size_t count = inflated.size() - stream.avail_out;
+                written += count;
+                crc = crc32(crc, reinterpret_cast<const Bytef*>(inflated.data()), count);
+                // Members inflating to more than they claim are cut off instead of filling the memory
+                if(written > entry.size || (count > 0 && !output(inflated.data(), count))) {
+                    success = false;
+                    break;
+                }
+                if(result == Z_STREAM_END) {
+                    finished = true;
+                    break;
+                }
+            } while(stream.avail_out == 0 || stream.avail_in > 0);
+            if(!finished && remaining == 0 && success) {
+                LOG_ERROR("ZipArchive %s is truncated!", entry.name.c_str());
+                success = false;
+            }
+        }
+        if(entry.method == METHOD_DEFLATED)
+            inflateEnd(&stream);
+        close(fd);
+        if(success && (written != entry.size || crc != entry.crc32)) {
+            LOG_ERROR("ZipArchive %s in %s is corrupted!", entry.name.c_str(), path.c_str());
+            success = false;
+        }
+        return success;
+    }
+
+    std::optional<std::string> ZipArchive::Read(std::string_view name) const {
+        auto entry = Find(name);
+        if(!entry)
+            return std::nullopt;
+        std::string data;
+        data.reserve(entry->size);
+        bool success = Inflate(*entry, [&data](const char* chunk, std::size_t size) {
+            data.append(chunk, size);
+            return true;
+        });
+        if(!success)
+            return std::nullopt;
+        return data;
+    }
+
+    bool ZipArchive::Extract(std::string_view name, std::string const& destinationPath) const {
+        auto entry = Find(name);
+        if(!entry)
+            return false;
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(destinationPath).parent_path(), ec);
+        std::string temporaryPath = destinationPath + ".tmp";
+        FILE* file = fopen(temporaryPath.c_str(), "wb");
+        if(!file) {
+            LOG_ERROR("ZipArchive Can't write %s: %s!", temporaryPath.c_str(), strerror(errno));
+            return false;
+        }
+        bool success = Inflate(*entry, [file](const char* chunk, std::size_t size) {
+            return fwrite(chunk, 1, size, file) == size;
+        });
+        success &= fclose(file) == 0;
+        if(success && rename(temporaryPath.c_str(), destinationPath.c_str()) == 0)
+            return true;
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+
+    std::mutex archivesMutex;
+    std::unordered_map<std::string, std::shared_ptr<ZipArchive>> archives;
+
+    std::shared_ptr<ZipArchive> GetArchive(std::string const& path) {
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+            return nullptr;
+        {
+            std::lock_guard<std::mutex> lock(archivesMutex);
+            auto search = archives.find(path);
+            if(search != archives.end()) {
+                auto& archive = search->second;
+                if(archive->GetFileSize() == static_cast<uint64_t>(info.st_size) && archive->GetLastWriteTime() == info.st_mtim.tv_sec)
+                    return archive;
+                archives.erase(search);
+            }
+        }
+        auto archive = ZipArchive::Open(path);
+        if(!archive)
+            return nullptr;
+        std::lock_guard<std::mutex> lock(archivesMutex);
+        // A refresh reads each archive a few times in a row, older ones aren't needed anymore
+        if(archives.size() >= MAX_CACHED_ARCHIVES)
+            archives.erase(archives.begin());
+        archives[path] = archive;
+        return archive;
+    }
+
+    std::optional<int> GetArchiveHash(std::string const& path) {
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            return std::nullopt;
+        return static_cast<int>(info.st_size ^ info.st_mtim.tv_sec);
+    }
+
+    std::optional<std::string> ReadLevelFile(std::string const& customLevelPath, std::string_view name) {
+        if(IsArchivePath(customLevelPath)) {
+            auto archive = GetArchive(customLevelPath);
+            if(!archive)
+                return std::nullopt;
+            return archive->Read(name);
+        }
+        std::string path = customLevelPath + "/" + std::string(name);
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            return std::nullopt;
+        return FileUtils::ReadAllText(path);
+    }
+
+    std::string GetExtractedFilesPath() {
+        return GetBaseLevelsPath() + ExtractedArchivesFolder + "/";
+    }
+
+    std::mutex extractMutex;
+
+    struct ExtractedFile {
+        std::string path;
+        // Same as GetArchiveHash of the archive it was extracted from
+        int archiveHash = 0;
+    };
+
+    // Paths the game builds like Song.zip/song.egg to their extracted copies, guarded by extractMutex
+    std::unordered_map<std::string, ExtractedFile> extractedFiles;
+
+    std::string_view TrimArchivePath(std::string_view archivePath) {
+        while(archivePath.ends_with('/'))
+            archivePath.remove_suffix(1);
+        return archivePath;
+    }
+
+    std::optional<std::string> FindExtractedFile(std::string_view archivePath, std::string_view name) {
+        archivePath = TrimArchivePath(archivePath);
+        auto archiveHash = GetArchiveHash(std::string(archivePath));
+        if(!archiveHash.has_value())
+            return std::nullopt;
+        std::string filePath = std::string(archivePath) + "/" + std::string(name);
+        std::lock_guard<std::mutex> lock(extractMutex);
+        auto search = extractedFiles.find(filePath);
+        // A replaced zip gets extracted again
+        if(search == extractedFiles.end() || search->second.archiveHash != *archiveHash)
+            return std::nullopt;
+        return search->second.path;
+    }
+
+    bool IsLevelFileExtracted(std::string const& customLevelPath, std::string_view name) {
+        return FindExtractedFile(customLevelPath, name).has_value();
+    }
+
+    std::optional<std::string> ExtractLevelFile(std::string const& customLevelPath, std::string_view name) {
+        if(!IsArchivePath(customLevelPath))
+            return customLevelPath + "/" + std::string(name);
+        if(!IsSafeMemberName(name)) {
+            LOG_ERROR("ExtractLevelFile %s of %s points outside the archive!", std::string(name).c_str(), customLevelPath.c_str());
+            return std::nullopt;
+        }
+        auto archive = GetArchive(customLevelPath);
+        if(!archive || !archive->Find(name))
+            return std::nullopt;
+        // Keyed by the archive's version, so a replaced zip never plays the old song
+        std::string_view archivePath = TrimArchivePath(customLevelPath);
+        auto archiveName = std::filesystem::path(archivePath).filename().string();
+        char version[32];
+        snprintf(version, sizeof(version), "_%llx_%llx", (unsigned long long) archive->GetFileSize(), (unsigned long long) archive->GetLastWriteTime());
+        std::string extractedPath = GetExtractedFilesPath() + archiveName + version + "/" + std::string(name);
+        std::lock_guard<std::mutex> lock(extractMutex);
+        struct stat info;
+        if(stat(extractedPath.c_str(), &info) != 0) {
+            if(!archive->Extract(name, extractedPath))
+                return std::nullopt;
+            LOG_INFO("Extracted %s from %s", std::string(name).c_str(), customLevelPath.c_str());
+        }
+        int archiveHash = static_cast<int>(archive->GetFileSize() ^ static_cast<uint64_t>(archive->GetLastWriteTime()));
+        extractedFiles[std::string(archivePath) + "/" + std::string(name)] = { extractedPath, archiveHash };
+        return extractedPath;
+    }
+
+    std::optional<std::string> ResolveArchiveFilePath(std::string_view filePath) {
+        // The game combines the level path with the file name, so a zipped song's files are below its zip
+        for(auto slash = filePath.find('/'); slash != std::string_view::npos; slash = filePath.find('/', slash + 1)) {
+            auto archivePath = filePath.substr(0, slash);
+            if(IsArchivePath(archivePath))
+                return FindExtractedFile(archivePath, filePath.substr(slash + 1));
+        }
+        return std::nullopt;
+    }
+
+    void ClearExtractedFiles() {
+        {
+            std::lock_guard<std::mutex> lock(extractMutex);
+            extractedFiles.clear();
+        }
+        auto extractedFilesPath = GetExtractedFilesPath();
+        struct stat info;
+        if(stat(extractedFilesPath.c_str(), &info) != 0)
+            return;
+        // Renaming is instant, the folder is deleted with the rest of the trash later
+        if(!FileUtils::MoveToTrash(extractedFilesPath, GetBaseLevelsPath() + TrashFolder + "/").has_value())
+            FileUtils::DeleteFolder(extractedFilesPath);
+    }
+
+}